@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "extend.h"
 #include "../util/algo/radix_sort.h"
 #include "target.h"
+#include "../util/parallel/thread_pool.h"
 
 using std::get;
 using std::tuple;
@@ -45,7 +46,7 @@ struct Align_fetcher
 		end_ = end;
 		queue_ = unique_ptr<Queue>(new Queue(qbegin, qend));
 	}
-	bool operator()(size_t query)
+	void operator()(size_t query)
 	{
 		const unsigned q = (unsigned)query,
 			c = align_mode.query_contexts;
@@ -55,15 +56,14 @@ struct Align_fetcher
 		end = it_;
 		this->query = query;
 		target_parallel = (end - begin > config.query_parallel_limit) && (config.frame_shift == 0 || (config.toppercent < 100 && config.query_range_culling));
-		return target_parallel;
 	}
 	bool get()
 	{
-		return queue_->get(*this) != Queue::end;
-	}
-	void release() {
-		if (target_parallel)
-			queue_->release();
+		if (queue_->get(*this) == Queue::end)
+			return false;
+		// Waits outside of the queue lock, so workers with queries inside the window keep fetching.
+		OutputSink::get().wait_window(query);
+		return true;
 	}
 	size_t query;
 	hit* begin, *end;
@@ -111,32 +111,30 @@ TextBuffer* legacy_pipeline(Align_fetcher &hits, const Metadata *metadata, const
 	return buf;
 }
 
-void align_worker(size_t thread_id, const Parameters *params, const Metadata *metadata)
+// Aligns the next query on a worker of the alignment pool, returns false if there are no queries left.
+// Target parallel queries split their work into tasks of the same pool, which idle workers pick up
+// before starting on new queries.
+bool align_worker(size_t thread_id, const Parameters *params, const Metadata *metadata, Statistics *stat)
 {
 	Align_fetcher hits;
-	Statistics stat;
-	DpStat dp_stat;
-	while (hits.get()) {
-		if(config.frame_shift != 0) {
-			TextBuffer *buf = legacy_pipeline(hits, metadata, params, stat);
-			OutputSink::get().push(hits.query, buf);
-			hits.release();
-			continue;
-		}
-		task_timer timer;
-		vector<Extension::Match> matches = Extension::extend(*params, hits.query, hits.begin, hits.end, *metadata, stat, hits.target_parallel || config.swipe_all ? DP::PARALLEL : 0);
-		TextBuffer *buf = blocked_processing ? Extension::generate_intermediate_output(matches, hits.query) : Extension::generate_output(matches, hits.query, stat, *metadata, *params);
-		if (!matches.empty() && (!config.unaligned.empty() || !config.aligned_file.empty())) {
-			std::lock_guard<std::mutex> lock(query_aligned_mtx);
-			query_aligned[hits.query] = true;
-		}
+	if (!hits.get())
+		return false;
+	if (config.frame_shift != 0) {
+		TextBuffer *buf = legacy_pipeline(hits, metadata, params, *stat);
 		OutputSink::get().push(hits.query, buf);
-		if (hits.target_parallel)
-			stat.inc(Statistics::TIME_TARGET_PARALLEL, timer.microseconds());
-		hits.release();
+		return true;
+	}
+	task_timer timer;
+	vector<Extension::Match> matches = Extension::extend(*params, hits.query, hits.begin, hits.end, *metadata, *stat, hits.target_parallel || config.swipe_all ? DP::PARALLEL : 0);
+	TextBuffer *buf = blocked_processing ? Extension::generate_intermediate_output(matches, hits.query) : Extension::generate_output(matches, hits.query, *stat, *metadata, *params);
+	if (!matches.empty() && (!config.unaligned.empty() || !config.aligned_file.empty())) {
+		std::lock_guard<std::mutex> lock(query_aligned_mtx);
+		query_aligned[hits.query] = true;
 	}
-	statistics += stat;
-	::dp_stat += dp_stat;
+	OutputSink::get().push(hits.query, buf);
+	if (hits.target_parallel)
+		stat->inc(Statistics::TIME_TARGET_PARALLEL, timer.microseconds());
+	return true;
 }
 
 void align_queries(Trace_pt_buffer &trace_pts, Consumer* output_file, const Parameters &params, const Metadata &metadata)
@@ -148,6 +146,8 @@ void align_queries(Trace_pt_buffer &trace_pts, Consumer* output_file, const Para
 	if (Stats::CBS::avg_matrix(config.comp_based_stats)) {
 		Extension::target_matrices.insert(Extension::target_matrices.end(), ref_seqs::get().get_length(), nullptr);
 		Extension::target_matrix_count = 0;
+		Extension::target_matrix_cache_hits = 0;
+		Extension::target_matrix_cache_misses = 0;
 	}
 	
 	trace_pts.load(max_size);
@@ -171,15 +171,19 @@ void align_queries(Trace_pt_buffer &trace_pts, Consumer* output_file, const Para
 
 		timer.go("Computing alignments");
 		Align_fetcher::init(query_range.first, query_range.second, hit_buf->data(), hit_buf->data() + hit_buf->size());
-		OutputSink::instance = unique_ptr<OutputSink>(new OutputSink(query_range.first, output_file));
-		vector<std::thread> threads;
+		OutputSink::instance = unique_ptr<OutputSink>(new OutputSink(query_range.first, output_file, config.output_membuf > 0.0 ? size_t(config.output_membuf * 1e9) : SIZE_MAX));
+		std::thread heartbeat;
 		if (config.verbosity >= 3 && config.load_balancing == Config::query_parallel && !config.no_heartbeat && !config.swipe_all)
-			threads.emplace_back(heartbeat_worker, query_range.second);
-		size_t n_threads = (config.load_balancing == Config::query_parallel && !config.swipe_all) ? (config.threads_align == 0 ? config.threads_ : config.threads_align) : 1;
-		for (size_t i = 0; i < n_threads; ++i)
-			threads.emplace_back(align_worker, i, &params, &metadata);
-		for (auto &t : threads)
-			t.join();
+			heartbeat = std::thread(heartbeat_worker, query_range.second);
+		const bool query_parallel = config.load_balancing == Config::query_parallel && !config.swipe_all;
+		const size_t n_threads = config.threads_align == 0 ? config.threads_ : config.threads_align;
+		Util::Parallel::WorkerLocal<Statistics> stats;
+		Util::Parallel::ThreadPool::get().run([&params, &metadata, &stats](size_t thread_id) { return align_worker(thread_id, &params, &metadata, &stats.get()); },
+			query_parallel ? n_threads : 1);
+		for (const Statistics& s : stats)
+			statistics += s;
+		if (heartbeat.joinable())
+			heartbeat.join();
 		statistics.inc(Statistics::TIME_EXT, timer.microseconds());
 		
 		timer.go("Deallocating buffers");
@@ -190,4 +194,6 @@ void align_queries(Trace_pt_buffer &trace_pts, Consumer* output_file, const Para
 		delete[] i;
 	Extension::target_matrices.clear();
 	statistics.inc(Statistics::MATRIX_ADJUST_COUNT, Extension::target_matrix_count);
+	statistics.inc(Statistics::MATRIX_CACHE_HITS, Extension::target_matrix_cache_hits);
+	statistics.inc(Statistics::MATRIX_CACHE_MISSES, Extension::target_matrix_cache_misses);
 }
\ No newline at end of file
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../dp/dp.h"
 #include "../../util/interval_partition.h"
 #include "../../util/simd.h"
+#include "../../util/parallel/thread_pool.h"
 
 using namespace std;
 
@@ -91,7 +92,7 @@ struct Target : public ::Target
 	{
 		filter_score = 0;
 		filter_evalue = DBL_MAX;
-		for (list<Hsp>::const_iterator i = hsps.begin(); i != hsps.end(); ++i) {
+		for (HspList::const_iterator i = hsps.begin(); i != hsps.end(); ++i) {
 			filter_score = std::max(filter_score, (int)i->score);
 			filter_evalue = std::min(filter_evalue, i->evalue);
 		}
@@ -107,7 +108,7 @@ struct Target : public ::Target
 		inner_culling();
 		if (config.frame_shift)
 			return;
-		for (list<Hsp>::iterator i = hsps.begin(); i != hsps.end(); ++i)
+		for (HspList::iterator i = hsps.begin(); i != hsps.end(); ++i)
 			i->query_source_range = TranslatedPosition::absolute_interval(TranslatedPosition(i->query_range.begin_, Frame(i->frame)), TranslatedPosition(i->query_range.end_, Frame(i->frame)), mapper.source_query_len);
 	}
 
@@ -153,12 +154,12 @@ void Pipeline::run_swipe(bool score_only)
 	vector<DpTarget> vf, vr;
 	for (size_t i = 0; i < n_targets(); ++i)
 		target(i).add(*this, vf, vr, (int)i);
-	list<Hsp> hsp;
+	HspList hsp;
 	hsp = banded_3frame_swipe(translated_query, FORWARD, vf.begin(), vf.end(), this->dp_stat, score_only, target_parallel);
 	hsp.splice(hsp.end(), banded_3frame_swipe(translated_query, REVERSE, vr.begin(), vr.end(), this->dp_stat, score_only, target_parallel));
 	
 	while (!hsp.empty()) {
-		list<Hsp> &l = target(hsp.begin()->swipe_target).hsps;
+		HspList &l = target(hsp.begin()->swipe_target).hsps;
 		l.splice(l.end(), hsp, hsp.begin());
 	}
 }
@@ -207,12 +208,10 @@ void Pipeline::run(Statistics &stat)
 			const size_t interval_count = (source_query_len + ::Target::INTERVAL - 1) / ::Target::INTERVAL;
 			for (vector<int32_t> &v : intervals)
 				v.resize(interval_count);
-			vector<thread> threads;
 			atomic<size_t> next(0);
-			for (unsigned i = 0; i < config.threads_; ++i)
-				threads.emplace_back(build_ranking_worker, targets.begin(), targets.end(), &next, &intervals[i]);
-			for (auto &t : threads)
-				t.join();
+			Util::Parallel::run_tasks(config.threads_, [&](size_t i) {
+				build_ranking_worker(targets.begin(), targets.end(), &next, &intervals[i]);
+			});
 
 			timer.go("Merging score ranking intervals");
 			for (auto it = intervals.begin() + 1; it < intervals.end(); ++it) {
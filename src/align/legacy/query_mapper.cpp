@@ -227,7 +227,7 @@ bool QueryMapper::generate_output(TextBuffer &buffer, Statistics &stat)
 		target_culling->add(targets[i]);
 		
 		hit_hsps = 0;
-		for (list<Hsp>::iterator j = targets[i].hsps.begin(); j != targets[i].hsps.end(); ++j) {
+		for (HspList::iterator j = targets[i].hsps.begin(); j != targets[i].hsps.end(); ++j) {
 			if (config.max_hsps > 0 && hit_hsps >= config.max_hsps)
 				break;
 
@@ -301,7 +301,7 @@ void Target::inner_culling()
 		filter_score = 0;
 		filter_evalue = DBL_MAX;
 	}
-	for (list<Hsp>::iterator i = hsps.begin(); i != hsps.end();) {
+	for (HspList::iterator i = hsps.begin(); i != hsps.end();) {
 		if (i->is_enveloped_by(hsps.begin(), i, 0.5))
 			i = hsps.erase(i);
 		else
@@ -311,7 +311,7 @@ void Target::inner_culling()
 
 void Target::apply_filters(int dna_len, int subject_len, const char *query_title, const char *ref_title)
 {
-	for (list<Hsp>::iterator i = hsps.begin(); i != hsps.end();) {
+	for (HspList::iterator i = hsps.begin(); i != hsps.end();) {
 		if (i->id_percent() < config.min_id
 			|| i->query_cover_percent(dna_len) < config.query_cover
 			|| i->subject_cover_percent(subject_len) < config.subject_cover)
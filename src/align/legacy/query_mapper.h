@@ -58,10 +58,10 @@ struct Seed_hit
 	{
 		return ungapped.score > rhs.ungapped.score;
 	}
-	bool is_enveloped(std::list<Hsp>::const_iterator begin, std::list<Hsp>::const_iterator end, int dna_len) const
+	bool is_enveloped(HspList::const_iterator begin, HspList::const_iterator end, int dna_len) const
 	{
 		const DiagonalSegment d(ungapped, ::Frame(frame_));
-		for (std::list<Hsp>::const_iterator i = begin; i != end; ++i)
+		for (HspList::const_iterator i = begin; i != end; ++i)
 			if (i->envelopes(d, dna_len))
 				return true;
 		return false;
@@ -149,7 +149,7 @@ struct Target
 	float filter_time;
 	bool outranked;
 	size_t begin, end;
-	list<Hsp> hsps;
+	HspList hsps;
 	list<Hsp_traits> ts;
 	Seed_hit top_hit;
 	std::set<unsigned> taxon_rank_ids;
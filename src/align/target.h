@@ -35,12 +35,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/data_structures/flat_array.h"
 #include "../basic/parameters.h"
 #include "../stats/cbs.h"
+#include "target_matrix_cache.h"
 
 namespace Extension {
 
 extern std::vector<int16_t*> target_matrices;
 extern std::mutex target_matrices_lock;
-extern std::atomic<size_t> target_matrix_count;
+extern std::atomic<size_t> target_matrix_count, target_matrix_cache_hits, target_matrix_cache_misses;
 
 struct SeedHit {
 	int diag() const {
@@ -71,7 +72,17 @@ struct WorkTarget {
 				++target_matrix_count;
 			}
 			if (target_matrices[block_id] == nullptr) {
-				int16_t* target_matrix = Stats::make_16bit_matrix(Stats::CompositionMatrixAdjust(l, l, c.data(), c.data(), Stats::CBS::AVG_MATRIX_SCALE, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs()));
+				int16_t* target_matrix = target_matrix_cache ? target_matrix_cache->get(block_id) : nullptr;
+				if (target_matrix)
+					++target_matrix_cache_hits;
+				else {
+					target_matrix = Stats::make_16bit_matrix(Stats::CompositionMatrixAdjust(l, l, c.data(), c.data(), Stats::CBS::AVG_MATRIX_SCALE, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs()));
+					++target_matrix_count;
+					if (target_matrix_cache) {
+						target_matrix_cache->put(block_id, target_matrix);
+						++target_matrix_cache_misses;
+					}
+				}
 				bool del = false;
 				{
 					std::lock_guard<std::mutex> lock(target_matrices_lock);
@@ -81,11 +92,10 @@ struct WorkTarget {
 				}
 				if (del)
 					delete[] target_matrix;
-				++target_matrix_count;
 			}
 			matrix = Stats::TargetMatrix(*query_matrix, target_matrices[block_id]);
 		}
-		else
+		else if (!config.cbs_batch)
 			matrix = Stats::TargetMatrix(query_comp, query_len, seq);
 	}
 	bool adjusted_matrix() const {
@@ -111,8 +121,8 @@ struct Target {
 		matrix(matrix)
 	{}
 
-	void add_hit(std::list<Hsp> &list, std::list<Hsp>::iterator it) {
-		std::list<Hsp> &l = hsp[it->frame];
+	void add_hit(HspList &list, HspList::iterator it) {
+		HspList &l = hsp[it->frame];
 		l.splice(l.end(), list, it);
 		filter_evalue = std::min(filter_evalue, l.back().evalue);
 		filter_score = std::max(filter_score, l.back().score);
@@ -139,7 +149,7 @@ struct Target {
 	int filter_score;
 	double filter_evalue;
 	int ungapped_score;
-	std::array<std::list<Hsp>, MAX_CONTEXT> hsp;
+	std::array<HspList, MAX_CONTEXT> hsp;
 	Stats::TargetMatrix matrix;
 };
 
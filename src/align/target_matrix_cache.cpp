@@ -0,0 +1,133 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include "target_matrix_cache.h"
+#include "../basic/config.h"
+#include "../data/reference.h"
+#include "../util/io/input_file.h"
+#include "../util/io/output_file.h"
+#include "../util/log_stream.h"
+#include "../util/system/system.h"
+
+using std::string;
+using std::vector;
+using std::endl;
+
+namespace Extension {
+
+TargetMatrixCache* target_matrix_cache = nullptr;
+
+// Approximate memory use of an entry including the hash table node.
+static const size_t ENTRY_SIZE = TargetMatrixCache::MATRIX_SIZE * sizeof(int16_t) + 32;
+
+TargetMatrixCache::TargetMatrixCache(size_t max_size, const DatabaseFile& db_file):
+	max_entries_(max_size / ENTRY_SIZE)
+{
+	memcpy(db_hash_, db_file.header2.hash, sizeof(db_hash_));
+	if (config.cbs_cache_persist && exists(file_name()))
+		load();
+}
+
+string TargetMatrixCache::file_name() {
+	return config.database + ".cbscache";
+}
+
+TargetMatrixCacheHeader TargetMatrixCache::header(size_t entries) const {
+	TargetMatrixCacheHeader h;
+	memcpy(h.db_hash, db_hash_, sizeof(h.db_hash));
+	strncpy(h.matrix, config.matrix.c_str(), sizeof(h.matrix) - 1);
+	h.flags = (config.masking == 1 && !config.no_ref_masking ? TargetMatrixCacheHeader::MASKED : 0)
+		| (config.target_seg != 0 ? TargetMatrixCacheHeader::TARGET_SEG : 0);
+	h.cbs_it_limit = config.cbs_it_limit;
+	h.cbs_err_tolerance = config.cbs_err_tolerance;
+	h.entries = entries;
+	return h;
+}
+
+void TargetMatrixCache::load() {
+	task_timer timer("Loading target matrix cache");
+	InputFile f(file_name());
+	TargetMatrixCacheHeader h;
+	const TargetMatrixCacheHeader expected = header(0);
+	if (f.read(&h, 1) != 1
+		|| h.magic_number != expected.magic_number
+		|| h.version != expected.version
+		|| memcmp(h.db_hash, expected.db_hash, sizeof(h.db_hash)) != 0
+		|| strncmp(h.matrix, expected.matrix, sizeof(h.matrix)) != 0
+		|| h.flags != expected.flags
+		|| h.cbs_it_limit != expected.cbs_it_limit
+		|| h.cbs_err_tolerance != expected.cbs_err_tolerance) {
+		f.close();
+		log_stream << "Target matrix cache " << file_name() << " does not match the current search." << endl;
+		return;
+	}
+	const size_t n = std::min((size_t)h.entries, max_entries_);
+	vector<uint32_t> ids(h.entries);
+	data_.resize(n * MATRIX_SIZE);
+	if (f.read(ids.data(), ids.size()) != ids.size() || f.read(data_.data(), data_.size()) != data_.size()) {
+		f.close();
+		data_.clear();
+		log_stream << "Target matrix cache " << file_name() << " is truncated." << endl;
+		return;
+	}
+	f.close();
+	index_.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+		index_[ids[i]] = (uint32_t)i;
+	timer.finish();
+	log_stream << "Loaded " << n << " target matrices from " << file_name() << endl;
+}
+
+void TargetMatrixCache::save() const {
+	task_timer timer("Writing target matrix cache");
+	std::lock_guard<std::mutex> lock(mtx_);
+	vector<uint32_t> ids(index_.size());
+	for (const auto& i : index_)
+		ids[i.second] = i.first;
+	const TargetMatrixCacheHeader h = header(ids.size());
+	OutputFile out(file_name());
+	out.write(&h, 1);
+	out.write(ids.data(), ids.size());
+	out.write(data_.data(), data_.size());
+	out.close();
+}
+
+int16_t* TargetMatrixCache::get(size_t block_id) {
+	const uint32_t id = block_to_database_id[block_id];
+	std::lock_guard<std::mutex> lock(mtx_);
+	const auto it = index_.find(id);
+	if (it == index_.end())
+		return nullptr;
+	int16_t* out = new int16_t[MATRIX_SIZE];
+	std::copy(data_.begin() + (size_t)it->second * MATRIX_SIZE, data_.begin() + ((size_t)it->second + 1) * MATRIX_SIZE, out);
+	return out;
+}
+
+void TargetMatrixCache::put(size_t block_id, const int16_t* matrix) {
+	const uint32_t id = block_to_database_id[block_id];
+	std::lock_guard<std::mutex> lock(mtx_);
+	if (index_.size() >= max_entries_)
+		return;
+	if (index_.emplace(id, (uint32_t)index_.size()).second)
+		data_.insert(data_.end(), matrix, matrix + MATRIX_SIZE);
+}
+
+}
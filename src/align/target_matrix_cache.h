@@ -0,0 +1,94 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include "../basic/const.h"
+#include "../basic/value.h"
+
+struct DatabaseFile;
+
+// Header of a persisted target matrix cache, followed by the database ids
+// of the cached sequences and their matrices of TRUE_AA * TRUE_AA scores.
+// The solver settings of the matrix adjustment are stored as they change
+// the matrices.
+struct TargetMatrixCacheHeader
+{
+	TargetMatrixCacheHeader() :
+		magic_number(MAGIC_NUMBER),
+		build(Const::build_version),
+		version(CURRENT_VERSION),
+		flags(0),
+		cbs_it_limit(0),
+		cbs_err_tolerance(0.0),
+		entries(0)
+	{
+		memset(db_hash, 0, sizeof(db_hash));
+		memset(matrix, 0, sizeof(matrix));
+	}
+	uint64_t magic_number;
+	uint32_t build, version;
+	char db_hash[16];
+	char matrix[32];
+	uint32_t flags;
+	int32_t cbs_it_limit;
+	double cbs_err_tolerance;
+	uint64_t entries;
+	enum { CURRENT_VERSION = 1 };
+	enum { MASKED = 1, TARGET_SEG = 2 };
+	static constexpr uint64_t MAGIC_NUMBER = 0x5d2b71c4e09a3f86llu;
+};
+
+namespace Extension {
+
+// Composition adjusted matrices of database sequences (--comp-based-stats 2) kept across query blocks. The cache
+// is keyed by database id and stops accepting matrices once its memory limit is reached.
+struct TargetMatrixCache {
+
+	TargetMatrixCache(size_t max_size, const DatabaseFile& db_file);
+	// Returns a copy of the matrix of the sequence with the given reference block id or nullptr if it is not cached.
+	int16_t* get(size_t block_id);
+	void put(size_t block_id, const int16_t* matrix);
+	void save() const;
+	static std::string file_name();
+
+	enum { MATRIX_SIZE = TRUE_AA * TRUE_AA };
+
+private:
+
+	TargetMatrixCacheHeader header(size_t entries) const;
+	void load();
+
+	const size_t max_entries_;
+	char db_hash_[16];
+	std::unordered_map<uint32_t, uint32_t> index_;
+	std::vector<int16_t> data_;
+	mutable std::mutex mtx_;
+
+};
+
+extern TargetMatrixCache* target_matrix_cache;
+
+}
@@ -46,7 +46,13 @@ namespace Extension {
 
 std::vector<int16_t*> target_matrices;
 std::mutex target_matrices_lock;
-atomic<size_t> target_matrix_count(0);
+atomic<size_t> target_matrix_count(0), target_matrix_cache_hits(0), target_matrix_cache_misses(0);
+
+// Number of targets per task of the batched matrix adjustment. One adjustment takes around 0.1ms, so a batch is a few
+// milliseconds of work, which keeps the scheduling overhead of the thread pool small, while a query with a few hundred
+// targets still yields enough tasks to keep the threads busy. Targets are solved sequentially within a batch, so the
+// size does not affect the vectorisation of the solver.
+static const size_t CBS_BATCH_SIZE = 64;
 
 WorkTarget ungapped_stage(SeedHit *begin, SeedHit *end, const sequence *query_seq, const Bias_correction *query_cb, const Stats::Composition& query_comp, const int16_t** query_matrix, uint32_t block_id, Statistics& stat) {
 	array<vector<Diagonal_segment>, MAX_CONTEXT> diagonal_segments;
@@ -81,7 +87,7 @@ WorkTarget ungapped_stage(SeedHit *begin, SeedHit *end, const sequence *query_se
 		if (diagonal_segments[frame].empty())
 			continue;
 		std::stable_sort(diagonal_segments[frame].begin(), diagonal_segments[frame].end(), Diagonal_segment::cmp_diag);
-		pair<int, list<Hsp_traits>> hsp = greedy_align(query_seq[frame], target.seq, diagonal_segments[frame].begin(), diagonal_segments[frame].end(), config.log_extend, frame);
+		pair<int, list<Hsp_traits>> hsp = (config.chaining == Chaining::SPARSE ? sparse_chain : greedy_align)(query_seq[frame], target.seq, diagonal_segments[frame].begin(), diagonal_segments[frame].end(), config.log_extend, frame);
 		target.hsp[frame] = std::move(hsp.second);
 		target.hsp[frame].sort(Hsp_traits::cmp_diag);
 	}
@@ -100,6 +106,26 @@ void ungapped_stage_worker(size_t i, size_t thread_id, const sequence *query_seq
 	delete[] query_matrix;
 }
 
+static void adjust_matrices(size_t batch, size_t thread_id, const sequence* query_seq, const Stats::Composition* query_comp, const vector<size_t>* order, vector<WorkTarget>* targets, mutex* mtx, Statistics* stat) {
+	task_timer timer;
+	const size_t begin = batch * CBS_BATCH_SIZE, end = std::min(begin + CBS_BATCH_SIZE, order->size());
+	vector<sequence> seqs;
+	seqs.reserve(end - begin);
+	for (size_t i = begin; i < end; ++i)
+		seqs.push_back((*targets)[(*order)[i]].seq);
+	vector<Stats::TargetMatrix> matrices = Stats::TargetMatrices(*query_comp, Stats::count_true_aa(query_seq[0]), seqs.data(), seqs.size());
+	size_t n = 0;
+	for (size_t i = begin; i < end; ++i) {
+		WorkTarget& target = (*targets)[(*order)[i]];
+		target.matrix = std::move(matrices[i - begin]);
+		if (target.adjusted_matrix())
+			++n;
+	}
+	std::lock_guard<mutex> lock(*mtx);
+	stat->inc(Statistics::TIME_MATRIX_ADJUST, timer.microseconds());
+	stat->inc(Statistics::MATRIX_ADJUST_COUNT, n);
+}
+
 vector<WorkTarget> ungapped_stage(const sequence *query_seq, const Bias_correction *query_cb, const Stats::Composition& query_comp, FlatArray<SeedHit> &seed_hits, const vector<uint32_t>& target_block_ids, int flags, Statistics& stat) {
 	vector<WorkTarget> targets;
 	if (target_block_ids.size() == 0)
@@ -115,6 +141,22 @@ vector<WorkTarget> ungapped_stage(const sequence *query_seq, const Bias_correcti
 			targets.push_back(ungapped_stage(seed_hits.begin(i), seed_hits.end(i), query_seq, query_cb, query_comp, &query_matrix, target_block_ids[i], stat));
 	}
 
+	if (config.cbs_batch) {
+		// The batches are formed in database order to keep the warm starts of the solver independent of the order in
+		// which the worker threads returned the targets.
+		vector<size_t> order(targets.size());
+		for (size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&targets](size_t a, size_t b) { return targets[a].block_id < targets[b].block_id; });
+		const size_t batches = (order.size() + CBS_BATCH_SIZE - 1) / CBS_BATCH_SIZE;
+		mutex mtx;
+		if (flags & DP::PARALLEL)
+			Util::Parallel::scheduled_thread_pool_auto(config.threads_, batches, adjust_matrices, query_seq, &query_comp, &order, &targets, &mtx, &stat);
+		else
+			for (size_t i = 0; i < batches; ++i)
+				adjust_matrices(i, 0, query_seq, &query_comp, &order, &targets, &mtx, &stat);
+	}
+
 	delete[] query_matrix;
 	return targets;
 }
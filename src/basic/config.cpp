@@ -44,6 +44,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/system/system.h"
 #include "../util/simd.h"
 #include "../util/parallel/multiprocessing.h"
+#include "../util/parallel/thread_pool.h"
 
 using namespace std;
 
@@ -114,6 +115,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 {
 	Command_line_parser parser;
 	parser.add_command("makedb", "Build DIAMOND database from a FASTA file", makedb)
+		.add_command("makeidx", "Build a reference seed index for a DIAMOND database", makeidx)
 		.add_command("blastp", "Align amino acid query sequences against a protein reference database", blastp)
 		.add_command("blastx", "Align DNA query sequences against a protein reference database", blastx)
 		.add_command("view", "View DIAMOND alignment archive (DAA) formatted file", view)
@@ -151,7 +153,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 #endif
 		;
 
-	string traceback_mode_str;
+	string traceback_mode_str, chaining_str;
 
 	Options_group general("General options");
 	general.add()
@@ -216,7 +218,9 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("in", 0, "input reference file in FASTA format", input_ref_file)
 		("taxonmap", 0, "protein accession to taxid mapping file", prot_accession2taxid)
 		("taxonnodes", 0, "taxonomy nodes.dmp from NCBI", nodesdmp)
-		("taxonnames", 0, "taxonomy names.dmp from NCBI", namesdmp);
+		("taxonnames", 0, "taxonomy names.dmp from NCBI", namesdmp)
+		("mmap-layout", 0, "write database in a layout that supports memory-mapped loading (--mmap-db)", mmap_layout)
+		("work-estimates", 0, "store per-sequence search work estimates for balancing multiprocessing runs", work_estimates);
 
 	Options_group cluster("");
 	cluster.add()
@@ -292,6 +296,11 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("ext-chunk-size", 0, "chunk size for adaptive ranking (default=auto)", ext_chunk_size)
 		("no-ranking", 0, "disable ranking heuristic", no_ranking)
 		("ext", 0, "Extension mode (banded-fast/banded-slow/full)", ext)
+		("cbs-cache", 0, "memory limit in GB for keeping composition adjusted target matrices across query blocks (default=0=off)", cbs_cache_size)
+		("cbs-cache-persist", 0, "load and store the target matrix cache in a file next to the database", cbs_cache_persist)
+		("cbs-batch", 0, "compute the composition adjusted matrices of the targets of a query in batches", cbs_batch)
+		("linear-traceback-cells", 0, "minimum size in cells of a DP matrix for computing its tracebacks in linear memory (slower, default=0=off)", linear_traceback_cells, (size_t)0)
+		("chaining", 0, "algorithm for chaining the ungapped hits of a target (greedy/sparse)", chaining_str, string("greedy"))
 		("culling-overlap", 0, "minimum range overlap with higher scoring hit to delete a hit (default=50%)", inner_culling_overlap, 50.0)
 		("taxon-k", 0, "maximum number of targets to report per species", taxon_k, (uint64_t)0)
 		("range-cover", 0, "percentage of query range to be covered for range culling (default=50%)", query_range_cover, 50.0)
@@ -302,6 +311,17 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("tantan-minMaskProb", 0, "minimum repeat probability for masking (default=0.9)", tantan_minMaskProb, 0.9)
 		("file-buffer-size", 0, "file buffer size in bytes (default=67108864)", file_buffer_size, (size_t)67108864)
 		("memory-limit", 'M', "Memory limit for extension stage in GB", memory_limit)
+		("memory-budget", 0, "Choose block size, index chunks and query bins not set explicitly to keep the predicted peak memory use below this value in GB (default=0=off)", memory_budget)
+		("estimate", 0, "Predict the run time, memory use and temporary disk space of the search from a sample of the input without running it", estimate)
+		("trace-pt-membuf", 0, "Memory budget in GB for keeping seed hits in memory instead of temporary files (default=0)", trace_pt_membuf, 0.0)
+		("output-membuf", 0, "Memory ceiling in GB for output buffered ahead of the slowest query (default=0=unlimited)", output_membuf, 0.0)
+		("cpu-affinity", 0, "Pin worker threads to CPU cores", cpu_affinity)
+		("numa", 0, "Spread worker threads and seed arrays over the NUMA nodes of the system", numa)
+		("overlap-shapes", 0, "Build the seed arrays of the next shape while searching the current one (uses memory for a second set of seed arrays)", overlap_shapes)
+		("sketch-seed-filter", 0, "Drop frequent seeds estimated from a count-min sketch before building the seed arrays (approximate, reduces seed array size and join work)", sketch_seed_filter)
+		("sketch-width", 0, "Maximum number of counters per row and shape of the seed sketch (default=0=auto)", sketch_width, (size_t)0)
+		("minimizer-window", 0, "Index only the window minimizers of the reference seeds for a smaller index at reduced sensitivity (window size in seed positions, default=0=off)", minimizer_window, 0u)
+		("compress-temp", 0, "Compression of temporary seed hit files (0=none, 1=delta encoding, 2=delta encoding+zlib)", compress_temp, 0u)
 		("no-unlink", 0, "Do not unlink temporary files.", no_unlink)
 		("cut-bar", 0, "", cut_bar)
 		("check-multi-target", 0, "", check_multi_target)
@@ -312,6 +332,9 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("target-indexed", 0, "", target_indexed)
 		("mmap-target-index", 0, "", mmap_target_index)
 		("save-target-index", 0, "", save_target_index)
+		("mmap-db", 0, "memory-map reference blocks instead of loading them (requires database built with --mmap-layout)", mmap_db)
+		("prefetch-blocks", 0, "load the next reference block in the background while searching the current one ", prefetch_blocks)
+		("prefetch-memory", 0, "memory limit in GB for the prefetched reference block (default=0=no limit)", prefetch_memory)
 		("log-evalue-scale", 0, "", log_evalue_scale, 1.0/std::log(2.0));
 
 	Options_group view_options("View options");
@@ -483,6 +506,15 @@ Config::Config(int argc, const char **argv, bool check_io)
 		{"vector", TracebackMode::VECTOR},
 		{"buffer", TracebackMode::SCORE_BUFFER} });
 
+	chaining = set_string_option<Chaining>(chaining_str, "--chaining",
+		{ {"greedy", Chaining::GREEDY},
+		{"sparse", Chaining::SPARSE} });
+
+	// An explicitly chosen traceback mode takes precedence over tracebacks in linear memory. The output formats set
+	// their default mode later on, where it can no longer be told apart.
+	if (traceback_mode != TracebackMode::NONE)
+		linear_traceback_cells = 0;
+
 	if (toppercent != 100.0 && max_alignments != 25)
 		throw std::runtime_error("--top and --max-target-seqs are mutually exclusive.");
 
@@ -532,6 +564,15 @@ Config::Config(int argc, const char **argv, bool check_io)
 	if (ext == "full" && comp_based_stats >= 2)
 		throw std::runtime_error("This mode of composition based stats is not supported for full matrix extension.");
 
+	if (cbs_cache_size > 0.0 && !Stats::CBS::avg_matrix(comp_based_stats))
+		throw std::runtime_error("--cbs-cache is only supported for --comp-based-stats 2.");
+
+	if (cbs_cache_persist && (cbs_cache_size == 0.0 || multiprocessing))
+		throw std::runtime_error("--cbs-cache-persist requires --cbs-cache and is not supported for multiprocessing.");
+
+	if (cbs_batch && (!Stats::CBS::matrix_adjust(comp_based_stats) || Stats::CBS::avg_matrix(comp_based_stats)))
+		throw std::runtime_error("--cbs-batch is only supported for --comp-based-stats 3, 4, 5 and 6.");
+
 	if (target_seg < 0 || target_seg > 1)
 		throw std::runtime_error("Permitted values for --target-seg: 0, 1");
 
@@ -576,6 +617,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 
 		switch (command) {
 		case Config::dbinfo:
+		case Config::makeidx:
 			if (database == "")
 				throw std::runtime_error("Missing parameter: database file (--db/-d)");
 		}
@@ -635,9 +677,11 @@ Config::Config(int argc, const char **argv, bool check_io)
 	verbose_stream << "Assertions enabled." << endl;
 #endif
 	set_option(threads_, std::thread::hardware_concurrency());
+	Util::Parallel::ThreadPool::init(threads_, cpu_affinity, numa);
 
 	switch (command) {
 	case Config::makedb:
+	case Config::makeidx:
 	case Config::blastp:
 	case Config::blastx:
 	case Config::view:
@@ -657,6 +701,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 	case Config::opt:
 	case Config::mask:
 	case Config::makedb:
+	case Config::makeidx:
 	case Config::cluster:
 	case Config::regression_test:
 	case Config::compute_medoids:
@@ -718,6 +763,13 @@ Config::Config(int argc, const char **argv, bool check_io)
 	if (algo == Config::query_indexed && (sensitivity == Sensitivity::MID_SENSITIVE || sensitivity >= Sensitivity::VERY_SENSITIVE))
 		throw std::runtime_error("Query-indexed mode is not supported for this sensitivity setting.");
 
+	// Reference minimizers are only indexed by the double-indexed search.
+	if (minimizer_window > 0) {
+		if (algo == Config::query_indexed || hashed_seeds || small_query)
+			throw std::runtime_error("--minimizer-window is only supported for the double-indexed search with spaced seeds.");
+		algo = Config::double_indexed;
+	}
+
 	set<string> ext_modes = { "", "banded-fast", "banded-slow" };
 #ifdef EXTRA
 	ext_modes.insert("full");
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 enum class Sensitivity { FAST = 0, DEFAULT = 1, MID_SENSITIVE = 2, SENSITIVE = 3, MORE_SENSITIVE = 4, VERY_SENSITIVE = 5, ULTRA_SENSITIVE = 6 };
 enum class TracebackMode { NONE = 0, SCORE_ONLY = 1, STAT = 2, VECTOR = 3, SCORE_BUFFER = 4 };
+enum class Chaining { GREEDY = 0, SPARSE = 1 };
 
 struct Config
 {
@@ -217,6 +218,8 @@ struct Config
 	size_t ext_chunk_size;
 	double ext_min_yield;
 	string ext;
+	double cbs_cache_size;
+	bool cbs_cache_persist;
 	int full_sw_len;
 	double relaxed_evalue_factor;
 	string type;
@@ -227,6 +230,16 @@ struct Config
 	bool fast_tsv;
 	unsigned target_parallel_verbosity;
 	double memory_limit;
+	double memory_budget;
+	bool estimate;
+	double trace_pt_membuf;
+	double output_membuf;
+	bool cpu_affinity;
+	bool numa;
+	bool overlap_shapes;
+	bool sketch_seed_filter;
+	size_t sketch_width;
+	unsigned minimizer_window;
 	size_t global_ranking_targets;
 	bool mode_mid_sensitive;
 	bool no_ranking;
@@ -249,6 +262,8 @@ struct Config
 	int target_seg;
 	double cbs_err_tolerance;
 	int cbs_it_limit;
+	bool cbs_batch;
+	size_t linear_traceback_cells;
 	double query_match_distance_threshold;
 	double length_ratio_threshold;
 	bool hash_join_swap;
@@ -259,9 +274,15 @@ struct Config
 	bool mode_fast;
 	double log_evalue_scale;
 	double ungapped_evalue_short;
+	bool mmap_layout;
+	bool work_estimates;
+	bool mmap_db;
+	bool prefetch_blocks;
+	double prefetch_memory;
 
 	Sensitivity sensitivity;
 	TracebackMode traceback_mode;
+	Chaining chaining;
 
 	bool multiprocessing;
 	bool mp_init;
@@ -270,7 +291,7 @@ struct Config
 		makedb = 0, blastp = 1, blastx = 2, view = 3, help = 4, version = 5, getseq = 6, benchmark = 7, random_seqs = 8, compare = 9, sort = 10, roc = 11, db_stat = 12, model_sim = 13,
 		match_file_stat = 14, model_seqs = 15, opt = 16, mask = 17, fastq2fasta = 18, dbinfo = 19, test_extra = 20, test_io = 21, db_annot_stats = 22, read_sim = 23, info = 24, seed_stat = 25,
 		smith_waterman = 26, cluster = 27, translate = 28, filter_blasttab = 29, show_cbs = 30, simulate_seqs = 31, split = 32, upgma = 33, upgma_mc = 34, regression_test = 35,
-		reverse_seqs = 36, compute_medoids = 37, mutate = 38, merge_tsv = 39, rocid = 40
+		reverse_seqs = 36, compute_medoids = 37, mutate = 38, merge_tsv = 39, rocid = 40, makeidx = 41
 	};
 	unsigned	command;
 
@@ -210,9 +210,9 @@ void Hsp::clear()
 	transcript.clear();
 }
 
-bool Hsp::is_weakly_enveloped_by(list<Hsp>::const_iterator begin, list<Hsp>::const_iterator end, int cutoff) const
+bool Hsp::is_weakly_enveloped_by(HspList::const_iterator begin, HspList::const_iterator end, int cutoff) const
 {
-	for (list<Hsp>::const_iterator i = begin; i != end; ++i)
+	for (HspList::const_iterator i = begin; i != end; ++i)
 		if (partial_score(*i) < cutoff)
 			return true;
 	return false;
@@ -223,9 +223,9 @@ bool Hsp::is_enveloped_by(const Hsp &hsp, double p) const
 	return query_source_range.overlap_factor(hsp.query_source_range) >= p || subject_range.overlap_factor(hsp.subject_range) >= p;
 }
 
-bool Hsp::is_enveloped_by(std::list<Hsp>::const_iterator begin, std::list<Hsp>::const_iterator end, double p) const
+bool Hsp::is_enveloped_by(HspList::const_iterator begin, HspList::const_iterator end, double p) const
 {
-	for (list<Hsp>::const_iterator i = begin; i != end; ++i)
+	for (HspList::const_iterator i = begin; i != end; ++i)
 		if (is_enveloped_by(*i, p))
 			return true;
 	return false;
@@ -17,18 +17,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <math.h>
+#include <string.h>
 #include <algorithm>
 #include <atomic>
 #include "masking.h"
 #include "../lib/tantan/LambdaCalculator.hh"
 #include "../util/tantan.h"
 #include "../lib/blast/blast_filter.h"
+#include "../util/algo/MurmurHash3.h"
+#include "../util/parallel/thread_pool.h"
 
 using namespace std;
 
 unique_ptr<Masking> Masking::instance;
 const int8_t Masking::bit_mask = (int8_t)128;
 
+static const float REPEAT_PROB = 0.005f, REPEAT_END_PROB = 0.05f, REPEAT_OFFSET_PROB_DECAY = 1.0f / 0.9f;
+
 Masking::Masking(const Score_matrix &score_matrix)
 {
 	const unsigned n = value_traits.alphabet_size;
@@ -51,6 +56,12 @@ Masking::Masking(const Score_matrix &score_matrix)
 	}
 	std::copy(likelihoodRatioMatrixf_, likelihoodRatioMatrixf_ + size, probMatrixPointersf_);
 
+	const float params[] = { REPEAT_PROB, REPEAT_END_PROB, REPEAT_OFFSET_PROB_DECAY, (float)config.tantan_minMaskProb };
+	char hash[16] = {};
+	MurmurHash3_x64_128(int_matrix, sizeof(int_matrix), hash, hash);
+	MurmurHash3_x64_128(params, sizeof(params), hash, hash);
+	memcpy(&signature_, hash, sizeof(signature_));
+
 	blast_seg_ = SegParametersNewAa();
 }
 
@@ -61,7 +72,7 @@ Masking::~Masking() {
 void Masking::operator()(Letter *seq, size_t len, Algo algo) const
 {
 	if(algo == Algo::TANTAN)
-		Util::tantan::mask(seq, (int)len, (const float**)probMatrixPointersf_, 0.005f, 0.05f, 1.0f / 0.9f, (float)config.tantan_minMaskProb, mask_table_x_);
+		Util::tantan::mask(seq, (int)len, (const float**)probMatrixPointersf_, REPEAT_PROB, REPEAT_END_PROB, REPEAT_OFFSET_PROB_DECAY, (float)config.tantan_minMaskProb, mask_table_x_);
 	else {
 		BlastSeqLoc* seg_locs;
 		SeqBufferSeg((uint8_t*)seq, len, 0u, blast_seg_, &seg_locs);
@@ -82,7 +93,7 @@ void Masking::operator()(Letter *seq, size_t len, Algo algo) const
 
 void Masking::mask_bit(Letter *seq, size_t len) const
 {
-	Util::tantan::mask(seq, (int)len, (const float**)probMatrixPointersf_, 0.005f, 0.05f, 1.0f / 0.9f, (float)config.tantan_minMaskProb, mask_table_bit_);
+	Util::tantan::mask(seq, (int)len, (const float**)probMatrixPointersf_, REPEAT_PROB, REPEAT_END_PROB, REPEAT_OFFSET_PROB_DECAY, (float)config.tantan_minMaskProb, mask_table_bit_);
 }
 
 void Masking::bit_to_hard_mask(Letter *seq, size_t len, size_t &n) const
@@ -113,12 +124,10 @@ void mask_worker(atomic<size_t> *next, Sequence_set *seqs, const Masking *maskin
 
 size_t mask_seqs(Sequence_set &seqs, const Masking &masking, bool hard_mask, Masking::Algo algo)
 {
-	vector<thread> threads;
 	atomic<size_t> next(0);
-	for (size_t i = 0; i < config.threads_; ++i)
-		threads.emplace_back(mask_worker, &next, &seqs, &masking, hard_mask, algo);
-	for (auto &t : threads)
-		t.join();
+	Util::Parallel::run_tasks(config.threads_, [&](size_t) {
+		mask_worker(&next, &seqs, &masking, hard_mask, algo);
+	});
 	size_t n = 0;
 	for (size_t i = 0; i < seqs.get_length(); ++i)
 		n += std::count(seqs[i].data(), seqs[i].end(), value_traits.mask_char);
@@ -34,6 +34,11 @@ struct Masking
 	void mask_bit(Letter *seq, size_t len) const;
 	void bit_to_hard_mask(Letter *seq, size_t len, size_t &n) const;
 	void remove_bit_mask(Letter *seq, size_t len) const;
+	// Identifies the parameters of tantan masking, stored in databases built with masking bits.
+	uint64_t signature() const
+	{
+		return signature_;
+	}
 	static const Masking& get()
 	{
 		return *instance;
@@ -45,6 +50,7 @@ private:
 	float likelihoodRatioMatrixf_[size][size], *probMatrixPointersf_[size];
 	Letter mask_table_x_[size], mask_table_bit_[size];
 	SegParameters* blast_seg_;
+	uint64_t signature_;
 };
 
 size_t mask_seqs(Sequence_set &seqs, const Masking &masking, bool hard_mask = true, Masking::Algo algo = Masking::Algo::TANTAN);
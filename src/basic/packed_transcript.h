@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../basic/value.h"
 #include "diagonal_segment.h"
 #include "sequence.h"
+#include "../util/memory/pool_allocator.h"
 
 typedef enum { op_match = 0, op_insertion = 1, op_deletion = 2, op_substitution = 3, op_frameshift_forward = 4, op_frameshift_reverse = 5 } Edit_operation;
 
@@ -96,6 +97,8 @@ struct Combined_operation
 struct Packed_transcript
 {
 
+	typedef vector<Packed_operation, Util::Memory::PoolAllocator<Packed_operation>> Data;
+
 	struct Const_iterator
 	{
 		Const_iterator(const Packed_operation *op):
@@ -144,7 +147,7 @@ struct Packed_transcript
 	Const_iterator begin() const
 	{ return Const_iterator (data_.data()); }
 
-	const vector<Packed_operation>& data() const
+	const Data& data() const
 	{ return data_; }
 
 	const Packed_operation* ptr() const
@@ -219,7 +222,7 @@ struct Packed_transcript
 
 private:
 
-	vector<Packed_operation> data_;
+	Data data_;
 
 	friend struct Hsp;
 
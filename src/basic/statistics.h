@@ -37,7 +37,7 @@ struct Statistics
 		SEARCH_TEMP_SPACE, SECONDARY_HITS, ERASED_HITS, SQUARED_ERROR, CELLS, TARGET_HITS0, TARGET_HITS1, TARGET_HITS2, TARGET_HITS3, TARGET_HITS3_CBS, TARGET_HITS4, TARGET_HITS5, TIME_GREEDY_EXT, LOW_COMPLEXITY_SEEDS,
 		SWIPE_REALIGN, EXT8, EXT16, EXT32, GAPPED_FILTER_TARGETS, GAPPED_FILTER_HITS1, GAPPED_FILTER_HITS2, GROSS_DP_CELLS, NET_DP_CELLS, TIME_TARGET_SORT, TIME_SW, TIME_EXT, TIME_GAPPED_FILTER,
 		TIME_LOAD_HIT_TARGETS, TIME_CHAINING, TIME_LOAD_SEED_HITS, TIME_SORT_SEED_HITS, TIME_SORT_TARGETS_BY_SCORE, TIME_TARGET_PARALLEL, TIME_TRACEBACK_SW, TIME_TRACEBACK, HARD_QUERIES, TIME_MATRIX_ADJUST,
-		MATRIX_ADJUST_COUNT, COUNT
+		MATRIX_ADJUST_COUNT, MATRIX_CACHE_HITS, MATRIX_CACHE_MISSES, COUNT
 	};
 
 	Statistics()
@@ -88,6 +88,7 @@ struct Statistics
 		log_stream << "Target hits (stage 5) = " << data_[TARGET_HITS5] << endl;
 		log_stream << "Swipe realignments    = " << data_[SWIPE_REALIGN] << endl;
 		log_stream << "Matrix adjusts        = " << data_[MATRIX_ADJUST_COUNT] << endl;
+		log_stream << "Matrix cache hits     = " << data_[MATRIX_CACHE_HITS] << " (" << data_[MATRIX_CACHE_HITS] * 100.0 / (data_[MATRIX_CACHE_HITS] + data_[MATRIX_CACHE_MISSES]) << " %)" << endl;
 		log_stream << "Extensions (8 bit)    = " << data_[EXT8] << endl;
 		log_stream << "Extensions (16 bit)   = " << data_[EXT16] << endl;
 		log_stream << "Extensions (32 bit)   = " << data_[EXT32] << endl;
@@ -102,6 +102,12 @@ static inline __m256i letter_mask(__m256i x) {
 }
 #endif
 
+#ifdef __AVX512BW__
+static inline __m512i letter_mask(__m512i x) {
+	return _mm512_and_si512(x, _mm512_set1_epi8(LETTER_MASK));
+}
+#endif
+
 extern const Value_traits amino_acid_traits;
 extern const Value_traits nucleotide_traits;
 extern Value_traits value_traits;
@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../stats/hauser_correction.h"
 
 std::pair<int, std::list<Hsp_traits>> greedy_align(sequence query, sequence subject, std::vector<Diagonal_segment>::const_iterator begin, std::vector<Diagonal_segment>::const_iterator end, bool log, unsigned frame);
+std::pair<int, std::list<Hsp_traits>> sparse_chain(sequence query, sequence subject, std::vector<Diagonal_segment>::const_iterator begin, std::vector<Diagonal_segment>::const_iterator end, bool log, unsigned frame);
+bool disjoint(std::list<Hsp_traits>::const_iterator begin, std::list<Hsp_traits>::const_iterator end, const Hsp_traits &t, int cutoff);
 
 struct Diagonal_node : public Diagonal_segment
 {
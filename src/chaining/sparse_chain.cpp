@@ -0,0 +1,273 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include "../basic/config.h"
+#include "../stats/score_matrix.h"
+#include "../dp/hsp_traits.h"
+#include "chaining.h"
+
+using std::vector;
+using std::list;
+using std::pair;
+using std::cout;
+using std::endl;
+
+// Maximum of the values of a fixed set of points (diagonal, position) over a range of diagonals and the positions up
+// to a bound. The outer segment tree is indexed by diagonal rank, each of its nodes keeps the sorted positions of the
+// points below it and a Fenwick tree of prefix maxima over them. Values may only increase.
+struct RangeMax2D {
+
+	struct Entry {
+		Entry() :
+			value(-std::numeric_limits<double>::infinity()),
+			node(Diag_graph::end)
+		{}
+		Entry(double value, size_t node) :
+			value(value),
+			node(node)
+		{}
+		bool operator<(const Entry& x) const {
+			return value < x.value;
+		}
+		double value;
+		size_t node;
+	};
+
+	void init(const vector<pair<int, int>>& points) {
+		diags_.clear();
+		for (const pair<int, int>& p : points)
+			diags_.push_back(p.first);
+		std::sort(diags_.begin(), diags_.end());
+		diags_.erase(std::unique(diags_.begin(), diags_.end()), diags_.end());
+		size_ = diags_.size();
+		vector<pair<int, size_t>> v;
+		v.reserve(points.size());
+		for (const pair<int, int>& p : points)
+			v.emplace_back(p.second, leaf(p.first));
+		std::sort(v.begin(), v.end());
+		offset_.assign(2 * size_ + 1, 0);
+		for (const pair<int, size_t>& p : v)
+			for (size_t t = p.second; t > 0; t >>= 1)
+				++offset_[t + 1];
+		for (size_t t = 1; t <= 2 * size_; ++t)
+			offset_[t] += offset_[t - 1];
+		pos_.resize(offset_[2 * size_]);
+		vector<size_t> fill(offset_.begin(), offset_.end() - 1);
+		for (const pair<int, size_t>& p : v)
+			for (size_t t = p.second; t > 0; t >>= 1)
+				pos_[fill[t]++] = p.first;
+		max_.assign(pos_.size(), Entry());
+	}
+
+	void update(int diag, int pos, const Entry& e) {
+		for (size_t t = leaf(diag); t > 0; t >>= 1) {
+			const size_t b = offset_[t], n = offset_[t + 1] - b;
+			for (size_t k = std::lower_bound(pos_.begin() + b, pos_.begin() + b + n, pos) - pos_.begin() - b + 1; k <= n; k += k & (0 - k))
+				max_[b + k - 1] = std::max(max_[b + k - 1], e);
+		}
+	}
+
+	// Returns the maximum over the points with diag_begin <= diagonal < diag_end and position <= pos_end.
+	Entry query(int diag_begin, int diag_end, int pos_end) const {
+		Entry r;
+		size_t l = std::lower_bound(diags_.begin(), diags_.end(), diag_begin) - diags_.begin() + size_,
+			h = std::lower_bound(diags_.begin(), diags_.end(), diag_end) - diags_.begin() + size_;
+		for (; l < h; l >>= 1, h >>= 1) {
+			if (l & 1)
+				r = std::max(r, prefix_max(l++, pos_end));
+			if (h & 1)
+				r = std::max(r, prefix_max(--h, pos_end));
+		}
+		return r;
+	}
+
+private:
+
+	size_t leaf(int diag) const {
+		return std::lower_bound(diags_.begin(), diags_.end(), diag) - diags_.begin() + size_;
+	}
+
+	Entry prefix_max(size_t t, int pos_end) const {
+		Entry r;
+		const size_t b = offset_[t];
+		for (size_t k = std::upper_bound(pos_.begin() + b, pos_.begin() + offset_[t + 1], pos_end) - pos_.begin() - b; k > 0; k -= k & (0 - k))
+			r = std::max(r, max_[b + k - 1]);
+		return r;
+	}
+
+	size_t size_;
+	vector<int> diags_, pos_;
+	vector<size_t> offset_;
+	vector<Entry> max_;
+
+};
+
+// Chains the diagonal segments of a target by sparse dynamic programming in O(n log^2 n) time. A segment e can precede
+// a segment d if it ends before d begins in both sequences. Linking them costs gap_open + |shift| * gap_extend for the
+// diagonal shift plus space_penalty for each letter of the remaining unaligned stretch. Since the cost is linear in the
+// coordinates of e for a fixed sign of the shift, the best predecessor is found by a range maximum query over the
+// diagonals on each side of d, where the position constraint of the shorter gap dimension implies the other one.
+struct SparseChainer {
+
+	enum { cutoff = 19 };
+
+	SparseChainer(const sequence& query, const sequence& subject, bool log, unsigned frame) :
+		query(query),
+		subject(subject),
+		log(log),
+		frame(frame),
+		go(score_matrix.gap_open()),
+		ge(score_matrix.gap_extend()),
+		space_penalty(0.1),
+		band(config.chaining_maxgap)
+	{}
+
+	// Value of e for predecessor queries from higher diagonals, where the query gap is the longer one.
+	double value_lower(size_t e) const {
+		return prefix_score[e] + ge * nodes[e].query_end() + (space_penalty - ge) * nodes[e].subject_end();
+	}
+
+	// Value of e for predecessor queries from lower diagonals, where the subject gap is the longer one.
+	double value_upper(size_t e) const {
+		return prefix_score[e] + ge * nodes[e].subject_end() + (space_penalty - ge) * nodes[e].query_end();
+	}
+
+	void forward_pass() {
+		vector<pair<int, int>> points;
+		points.reserve(nodes.size());
+		for (const Diagonal_node& d : nodes)
+			points.emplace_back(d.diag(), 0);
+		lower.init(points);
+		points.clear();
+		for (const Diagonal_node& d : nodes)
+			points.emplace_back(d.diag(), d.query_end());
+		upper.init(points);
+
+		// Predecessors on the same or lower diagonals are inserted once the sweep passes their subject end, which
+		// leaves a range query over the diagonals only. Predecessors on higher diagonals need the query end as second
+		// dimension.
+		vector<size_t> by_end(nodes.size());
+		for (size_t k = 0; k < nodes.size(); ++k)
+			by_end[k] = k;
+		std::sort(by_end.begin(), by_end.end(), [this](size_t x, size_t y) { return nodes[x].subject_end() < nodes[y].subject_end(); });
+		vector<size_t>::const_iterator next = by_end.begin();
+
+		prefix_score.assign(nodes.size(), 0);
+		pred.assign(nodes.size(), Diag_graph::end);
+		for (size_t k = 0; k < nodes.size(); ++k) {
+			const Diagonal_node& d = nodes[k];
+			const int dd = d.diag();
+			for (; next < by_end.end() && nodes[*next].subject_end() <= d.j; ++next)
+				lower.update(nodes[*next].diag(), 0, RangeMax2D::Entry(value_lower(*next), *next));
+			const double offset_lower = ge * d.i + (space_penalty - ge) * d.j,
+				offset_upper = ge * d.j + (space_penalty - ge) * d.i;
+			RangeMax2D::Entry e = lower.query(dd, dd + 1, 0), best(e.value - offset_lower, e.node);
+			e = lower.query(dd - band, dd, 0);
+			best = std::max(best, RangeMax2D::Entry(e.value - offset_lower - go, e.node));
+			e = upper.query(dd + 1, dd + band + 1, d.i);
+			best = std::max(best, RangeMax2D::Entry(e.value - offset_upper - go, e.node));
+			const int link = best.node == Diag_graph::end ? 0 : (int)floor(best.value);
+			if (link > 0) {
+				prefix_score[k] = d.score + link;
+				pred[k] = best.node;
+			}
+			else
+				prefix_score[k] = d.score;
+			upper.update(dd, d.query_end(), RangeMax2D::Entry(value_upper(k), k));
+			if (log)
+				cout << "Node " << k << " d=" << dd << " i=" << d.i << " j=" << d.j << " score=" << d.score << " prefix_score=" << prefix_score[k] << " pred=" << (int)pred[k] << endl;
+		}
+	}
+
+	int backtrace(list<Hsp_traits>& ts) {
+		vector<size_t> top_nodes;
+		for (size_t k = 0; k < nodes.size(); ++k)
+			if (prefix_score[k] >= cutoff)
+				top_nodes.push_back(k);
+		std::sort(top_nodes.begin(), top_nodes.end(), [this](size_t x, size_t y) { return prefix_score[x] > prefix_score[y] || (prefix_score[x] == prefix_score[y] && x < y); });
+		vector<bool> used(nodes.size(), false);
+		int max_score = 0;
+		for (size_t top : top_nodes) {
+			if (used[top])
+				continue;
+			const Diagonal_node& d = nodes[top];
+			Hsp_traits t(frame);
+			t.d_min = t.d_max = d.diag();
+			t.query_range.end_ = d.query_end();
+			t.subject_range.end_ = d.subject_end();
+			size_t node = top;
+			used[node] = true;
+			while (pred[node] != Diag_graph::end && !used[pred[node]]) {
+				node = pred[node];
+				used[node] = true;
+				t.d_min = std::min(t.d_min, nodes[node].diag());
+				t.d_max = std::max(t.d_max, nodes[node].diag());
+			}
+			t.query_range.begin_ = nodes[node].i;
+			t.subject_range.begin_ = nodes[node].j;
+			t.score = prefix_score[top] - prefix_score[node] + nodes[node].score;
+			if (log)
+				cout << "Chain top=" << top << " begin=" << node << " score=" << t.score << endl;
+			if (t.score >= cutoff && disjoint(ts.begin(), ts.end(), t, cutoff)) {
+				ts.push_back(t);
+				max_score = std::max(max_score, t.score);
+			}
+		}
+		return max_score;
+	}
+
+	int run(list<Hsp_traits>& ts, vector<Diagonal_segment>::const_iterator begin, vector<Diagonal_segment>::const_iterator end) {
+		Diag_graph diags;
+		diags.load(begin, end);
+		diags.sort();
+		diags.prune();
+		nodes = std::move(diags.nodes);
+		std::sort(nodes.begin(), nodes.end(), Diagonal_segment::cmp_subject);
+		forward_pass();
+		return backtrace(ts);
+	}
+
+	const sequence query, subject;
+	const bool log;
+	const unsigned frame;
+	const int go, ge;
+	const double space_penalty;
+	const int band;
+	vector<Diagonal_node> nodes;
+	vector<int> prefix_score;
+	vector<size_t> pred;
+	RangeMax2D lower, upper;
+
+};
+
+std::pair<int, list<Hsp_traits>> sparse_chain(sequence query, sequence subject, vector<Diagonal_segment>::const_iterator begin, vector<Diagonal_segment>::const_iterator end, bool log, unsigned frame)
+{
+	if (end - begin == 1)
+		return { begin->score, { { begin->diag(), begin->diag(), begin->score, (int)frame, begin->query_range(), begin->subject_range() } } };
+	SparseChainer chainer(query, subject, log, frame);
+	list<Hsp_traits> ts;
+	const int score = chainer.run(ts, begin, end);
+	return std::make_pair(score, std::move(ts));
+}
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iomanip>
 #include "mcl.h"
 #include "sparse_matrix_stream.h"
+#include "../util/parallel/thread_pool.h"
 
 #define MASK_INVERSE        0xC000000000000000
 #define MASK_NORMAL_NODE    0x4000000000000000
@@ -88,14 +89,7 @@ void MCL::get_exp(Eigen::SparseMatrix<float>* in, Eigen::SparseMatrix<float>* ou
 				m.unlock();
 			};
 
-			vector<thread> threads;
-			for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-				threads.emplace_back(mult, iThread);
-			}
-
-			for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-				threads[iThread].join();
-			}
+			Util::Parallel::run_tasks(nThr, [&mult](size_t iThread) { mult((uint32_t)iThread); });
 			out->setZero();
 			out->setFromTriplets(data.begin(), data.end(), [] (const float&, const float &b) { return b; });
 			*out = out->pruned(1.0, numeric_limits<float>::epsilon());
@@ -168,14 +162,7 @@ void MCL::get_gamma(Eigen::SparseMatrix<float>* in, Eigen::SparseMatrix<float>*
 		m.unlock();
 	};
 
-	vector<thread> threads;
-	for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-		threads.emplace_back(mult, iThread);
-	}
-
-	for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-		threads[iThread].join();
-	}
+	Util::Parallel::run_tasks(nThr, [&mult](size_t iThread) { mult((uint32_t)iThread); });
 	out->setZero();
 	out->setFromTriplets(data.begin(), data.end(), [] (const float&, const float &b) { return b; });
 	*out = out->pruned(1.0, numeric_limits<float>::epsilon());
@@ -195,14 +182,7 @@ float get_norm(Eigen::SparseMatrix<float>* in, uint32_t nThr){
 		}
 	};
 
-	vector<thread> threads;
-	for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-		threads.emplace_back(norm, iThread);
-	}
-
-	for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-		threads[iThread].join();
-	}
+	Util::Parallel::run_tasks(nThr, [&norm](size_t iThread) { norm((uint32_t)iThread); });
 	return pow(accumulate(data.begin(), data.end(), 0.0f), 0.5f);
 }
 
@@ -668,14 +648,7 @@ void MCL::run(){
 		time_per_thread[iThr] = (chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - thread_start).count()) / 1000.0;
 	};
 
-	vector<thread> threads;
-	for(uint32_t iThread = 0; iThread < nThreads ; iThread++) {
-		threads.emplace_back(mcl_clustering, iThread);
-	}
-
-	for(uint32_t iThread = 0; iThread < nThreads ; iThread++) {
-		threads[iThread].join();
-	}
+	Util::Parallel::run_tasks(nThreads, [&mcl_clustering](size_t iThread) { mcl_clustering((uint32_t)iThread); });
 	ms->release_read_buffer();
 	delete ms;
 	timer.finish();
@@ -0,0 +1,102 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include "block_loader.h"
+#include "../basic/config.h"
+#include "../basic/masking.h"
+#include "../util/log_stream.h"
+#include "../search/memory_plan.h"
+
+BlockLoader::BlockLoader(DatabaseFile &db_file, const BitVector *filter, bool prefetch, bool mask) :
+	db_file_(db_file),
+	filter_(filter),
+	prefetch_(prefetch),
+	mask_(mask),
+	current_masked_(false)
+{
+	db_file_.silent_load = true;
+}
+
+BlockLoader::~BlockLoader()
+{
+	if (thread_.joinable())
+		thread_.join();
+	if (next_.loaded) {
+		delete next_.seqs;
+		delete next_.ids;
+	}
+	db_file_.silent_load = false;
+}
+
+void BlockLoader::load(DatabaseFile *db_file, const BitVector *filter, bool mask, Block *block)
+{
+	try {
+		block->loaded = db_file->load_seqs(&block->block2db_id, (size_t)(config.chunk_size * 1e9), &block->seqs, &block->ids, true, filter);
+		if (block->loaded && mask) {
+			block->masked_letters = mask_seqs(*block->seqs, Masking::get());
+			block->masked = true;
+		}
+	}
+	catch (...) {
+		block->error = std::current_exception();
+	}
+}
+
+bool BlockLoader::fits_memory_limit() const
+{
+	if (config.prefetch_memory == 0.0)
+		return true;
+	// The next block is assumed to be of the same size as the current one.
+	const Sequence_set& seqs = ref_seqs::get();
+	return Search::ref_block_memory((double)seqs.letters(), (double)seqs.avg_len()) <= config.prefetch_memory * 1e9;
+}
+
+bool BlockLoader::next()
+{
+	task_timer timer("Loading reference sequences");
+	if (thread_.joinable())
+		thread_.join();
+	else
+		load(&db_file_, filter_, false, &next_);
+	if (next_.error)
+		std::rethrow_exception(next_.error);
+	if (!next_.loaded)
+		return false;
+
+	ref_seqs::data_ = next_.seqs;
+	ref_ids::data_ = next_.ids;
+	block_to_database_id = std::move(next_.block2db_id);
+	current_masked_ = next_.masked;
+	timer.finish();
+	ref_seqs::get().print_stats();
+	if (current_masked_)
+		log_stream << "Masked letters: " << next_.masked_letters << std::endl;
+	next_ = Block();
+
+	if (prefetch_) {
+		if (fits_memory_limit())
+			thread_ = std::thread(load, &db_file_, filter_, mask_, &next_);
+		else
+			log_stream << "Not prefetching the next reference block due to --prefetch-memory." << std::endl;
+	}
+	return true;
+}
@@ -0,0 +1,76 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <thread>
+#include <vector>
+#include <exception>
+#include <stdint.h>
+#include "reference.h"
+
+// Loads the reference blocks of a database in order. With prefetching enabled,
+// the next block is read (and masked, if requested) on a background thread
+// while the current block is being searched and aligned.
+struct BlockLoader
+{
+	BlockLoader(DatabaseFile &db_file, const BitVector *filter, bool prefetch, bool mask);
+	~BlockLoader();
+	// Makes the next block current in ref_seqs, ref_ids and block_to_database_id.
+	// Returns false if all blocks have been loaded.
+	bool next();
+	// Whether the current block has already been masked.
+	bool masked() const
+	{
+		return current_masked_;
+	}
+
+private:
+
+	struct Block
+	{
+		Block() :
+			seqs(nullptr),
+			ids(nullptr),
+			loaded(false),
+			masked(false),
+			masked_letters(0)
+		{}
+		Sequence_set *seqs;
+		String_set<char, 0> *ids;
+		std::vector<uint32_t> block2db_id;
+		bool loaded, masked;
+		size_t masked_letters;
+		std::exception_ptr error;
+	};
+
+	static void load(DatabaseFile *db_file, const BitVector *filter, bool mask, Block *block);
+	// Whether the predicted size of the next block fits into the --prefetch-memory budget.
+	bool fits_memory_limit() const;
+
+	DatabaseFile &db_file_;
+	const BitVector *filter_;
+	const bool prefetch_, mask_;
+	bool current_masked_;
+	Block next_;
+	std::thread thread_;
+
+};
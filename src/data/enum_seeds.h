@@ -1,6 +1,8 @@
 #pragma once
 
 #include "sequence_set.h"
+#include "../util/parallel/thread_pool.h"
+#include "../util/hash_function.h"
 
 template<typename _f, typename _filter>
 void enum_seeds(const Sequence_set* seqs, _f* f, unsigned begin, unsigned end, std::pair<size_t, size_t> shape_range, const _filter* filter)
@@ -131,12 +133,80 @@ struct No_filter
 
 extern No_filter no_filter;
 
+// Keeps only the window minimizers among the seeds accepted by the inner filter: of every window of consecutive seed
+// positions of a sequence, the seed with the smallest hash value is enumerated.
+template<typename _filter>
+struct Minimizer_filter
+{
+	Minimizer_filter(const _filter* filter, unsigned window):
+		filter(filter),
+		window(window)
+	{}
+	bool contains(uint64_t seed, uint64_t shape) const
+	{
+		return filter->contains(seed, shape);
+	}
+	const _filter* filter;
+	const unsigned window;
+};
+
+template<typename _f, typename _filter>
+void enum_seeds_minimizer(const Sequence_set* seqs, _f* f, unsigned begin, unsigned end, std::pair<size_t, size_t> shape_range, const Minimizer_filter<_filter>* filter)
+{
+	vector<Letter> buf(seqs->max_len(begin, end));
+	vector<uint64_t> keys, hashes;
+	vector<size_t> window;
+	const size_t w = std::max(filter->window, 1u);
+	for (unsigned i = begin; i < end; ++i) {
+		const sequence seq = (*seqs)[i];
+		Reduction::reduce_seq(seq, buf);
+		for (size_t shape_id = shape_range.first; shape_id < shape_range.second; ++shape_id) {
+			const Shape& sh = shapes[shape_id];
+			if (seq.length() < sh.length_) continue;
+			keys.clear();
+			hashes.clear();
+			Seed_iterator it(buf, sh);
+			uint64_t key;
+			while (it.good()) {
+				const bool valid = it.get(key, sh) && filter->contains(key, shape_id);
+				keys.push_back(key);
+				hashes.push_back(valid ? murmur_hash()(key) : UINT64_MAX);
+			}
+
+			// Sliding window minimum, ties are broken towards the leftmost position.
+			const size_t n = keys.size();
+			size_t last = SIZE_MAX;
+			window.clear();
+			size_t head = 0;
+			for (size_t j = 0; j < n; ++j) {
+				while (window.size() > head && hashes[window.back()] > hashes[j])
+					window.pop_back();
+				window.push_back(j);
+				if (window[head] + w <= j)
+					++head;
+				if (j + 1 < std::min(w, n))
+					continue;
+				const size_t m = window[head];
+				if (m != last && hashes[m] != UINT64_MAX) {
+					(*f)(keys[m], seqs->position(i, m), shape_id);
+					last = m;
+				}
+			}
+		}
+	}
+	f->finish();
+}
+
+template<typename _f, typename _filter>
+static void enum_seeds_worker(_f* f, const Sequence_set* seqs, unsigned begin, unsigned end, std::pair<size_t, size_t> shape_range, const Minimizer_filter<_filter>* filter, bool contig)
+{
+	enum_seeds_minimizer<_f, _filter>(seqs, f, begin, end, shape_range, filter);
+}
+
 template <typename _f, typename _filter>
 void enum_seeds(const Sequence_set* seqs, PtrVector<_f>& f, const std::vector<size_t>& p, size_t shape_begin, size_t shape_end, const _filter* filter, bool contig = false)
 {
-	std::vector<std::thread> threads;
-	for (unsigned i = 0; i < f.size(); ++i)
-		threads.emplace_back(enum_seeds_worker<_f, _filter>, &f[i], seqs, (unsigned)p[i], (unsigned)p[i + 1], std::make_pair(shape_begin, shape_end), filter, contig);
-	for (auto& t : threads)
-		t.join();
+	Util::Parallel::run_tasks(f.size(), [&](size_t i) {
+		enum_seeds_worker(&f[i], seqs, (unsigned)p[i], (unsigned)p[i + 1], std::make_pair(shape_begin, shape_end), filter, contig);
+	});
 }
\ No newline at end of file
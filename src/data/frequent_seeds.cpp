@@ -88,11 +88,9 @@ void Frequent_seeds::build(unsigned sid, const SeedPartitionRange &range, Double
 {
 	vector<Sd> ref_sds(range.size()), query_sds(range.size());
 	atomic<unsigned> seedp(range.begin());
-	vector<std::thread> threads;
-	for (unsigned i = 0; i < config.threads_; ++i)
-		threads.emplace_back(compute_sd, &seedp, query_seed_hits, ref_seed_hits, &ref_sds, &query_sds);
-	for (auto &t : threads)
-		t.join();
+	Util::Parallel::run_tasks(config.threads_, [&](size_t) {
+		compute_sd(&seedp, query_seed_hits, ref_seed_hits, &ref_sds, &query_sds);
+	});
 
 	Sd ref_sd(ref_sds), query_sd(query_sds);
 	const unsigned ref_max_n = (unsigned)(ref_sd.mean() + config.freq_sd*ref_sd.sd()), query_max_n = (unsigned)(query_sd.mean() + config.freq_sd*query_sd.sd());
@@ -28,6 +28,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <memory>
 #include <algorithm>
 #include <cmath>
+#include <thread>
+#include <exception>
 #include "../basic/config.h"
 #include "reference.h"
 #include "load_seqs.h"
@@ -42,9 +44,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/algo/MurmurHash3.h"
 #include "../util/io/record_reader.h"
 #include "../util/parallel/multiprocessing.h"
+#include "../util/system/system.h"
+#include "../util/parallel/thread_pool.h"
+#include "seq_work.h"
 
 String_set<char, '\0'>* ref_ids::data_ = nullptr;
 Partitioned_histogram ref_hst;
+Seed_sketch *ref_sketch = nullptr;
 unsigned current_ref_block;
 Sequence_set* ref_seqs::data_ = nullptr;
 Sequence_set* ref_seqs_unmasked::data_ = nullptr;
@@ -58,7 +64,7 @@ Serializer& operator<<(Serializer &s, const ReferenceHeader2 &h)
 	s.unset(Serializer::VARINT);
 	s << sizeof(ReferenceHeader2);
 	s.write(h.hash, sizeof(h.hash));
-	s << h.taxon_array_offset << h.taxon_array_size << h.taxon_nodes_offset << h.taxon_names_offset;
+	s << h.taxon_array_offset << h.taxon_array_size << h.taxon_nodes_offset << h.taxon_names_offset << h.flags << h.masking_signature;
 	return s;
 }
 
@@ -69,6 +75,8 @@ Deserializer& operator>>(Deserializer &d, ReferenceHeader2 &h)
 		>> h.taxon_array_size
 		>> h.taxon_nodes_offset
 		>> h.taxon_names_offset
+		>> h.flags
+		>> h.masking_signature
 		>> Finish();
 	return d;
 }
@@ -91,23 +99,25 @@ struct Pos_record
 {
 	Pos_record()
 	{}
-	Pos_record(uint64_t pos, size_t len):
+	Pos_record(uint64_t pos, size_t len, uint32_t work = 0):
 		pos(pos),
-		seq_len(uint32_t(len))
+		seq_len(uint32_t(len)),
+		work(work)
 	{}
 	uint64_t pos;
 	uint32_t seq_len;
+	// Estimated search work of the sequence (see WorkSketch), 0 in databases without work estimates.
+	uint32_t work;
 	enum { SIZE = 16 };
 };
 
 InputFile& operator>>(InputFile& file, Pos_record& r) {
-	uint32_t p;
-	file >> r.pos >> r.seq_len >> p;
+	file >> r.pos >> r.seq_len >> r.work;
 	return file;
 }
 
 Serializer& operator<<(Serializer& file, const Pos_record& r) {
-	file << r.pos << r.seq_len << (uint32_t)0;
+	file << r.pos << r.seq_len << r.work;
 	return file;
 }
 
@@ -116,12 +126,51 @@ void DatabaseFile::init()
 	read_header(*this, ref_header);
 	if (ref_header.build < min_build_required || ref_header.db_version < MIN_DB_VERSION)
 		throw std::runtime_error("Database was built with an older version of Diamond and is incompatible.");
-	if (ref_header.db_version > ReferenceHeader::current_db_version)
+	if (ref_header.db_version > ReferenceHeader::MMAP_DB_VERSION)
 		throw std::runtime_error("Database was built with a newer version of Diamond and is incompatible.");
 	if (ref_header.sequences == 0)
 		throw std::runtime_error("Incomplete database file. Database building did not complete successfully.");
 	*this >> header2;
 	pos_array_offset = ref_header.pos_array_offset;
+	map_ = nullptr;
+	direct_seq_ = 0;
+	load_masked = false;
+	silent_load = false;
+	if (mmap_layout()) {
+		auto f = mmap_file(file_name.c_str());
+		if (get<0>(f) == nullptr)
+			throw std::runtime_error("Error mapping database file: " + file_name);
+		map_ = get<0>(f);
+		map_size_ = get<1>(f);
+		map_fd_ = get<2>(f);
+	}
+}
+
+bool DatabaseFile::mmap_layout() const {
+	return ref_header.db_version >= ReferenceHeader::MMAP_DB_VERSION;
+}
+
+bool DatabaseFile::has_stored_masking() const {
+	return (header2.flags & ReferenceHeader2::STORED_MASKING) && header2.masking_signature == Masking::get().signature();
+}
+
+bool DatabaseFile::has_work_estimates() const {
+	return header2.flags & ReferenceHeader2::WORK_ESTIMATES;
+}
+
+void DatabaseFile::unpack_masking(Letter *seq, size_t len, size_t &masked) const {
+	if (load_masked)
+		Masking::get().bit_to_hard_mask(seq, len, masked);
+	else
+		Masking::get().remove_bit_mask(seq, len);
+}
+
+uint64_t DatabaseFile::seq_pos(size_t i) const {
+	return *(const uint64_t*)(map_ + ref_header.pos_array_offset + Pos_record::SIZE * i);
+}
+
+uint64_t DatabaseFile::id_pos(size_t i) const {
+	return *(const uint64_t*)(map_ + ref_header.pos_array_offset + Pos_record::SIZE * (ref_header.sequences + 1) + sizeof(uint64_t) * i);
 }
 
 DatabaseFile::DatabaseFile(const string &input_file):
@@ -139,6 +188,10 @@ DatabaseFile::DatabaseFile(TempFile &tmp_file):
 }
 
 void DatabaseFile::close() {
+	if (map_) {
+		unmap_file(map_, map_size_, map_fd_);
+		map_ = nullptr;
+	}
 	if (temporary)
 		InputFile::close_and_delete();
 	else
@@ -189,6 +242,104 @@ void push_seq(const sequence &seq, const char *id, size_t id_len, uint64_t &offs
 	offset += seq.length() + id_len + 3;
 }
 
+void push_seq_mmap_layout(const sequence &seq, const char *id, size_t id_len, uint64_t &offset, vector<Pos_record> &pos_array, vector<uint64_t> &id_pos_array, OutputFile &out, OutputFile &id_out, size_t &letters, size_t &n_seqs)
+{
+	pos_array.emplace_back(offset, seq.length());
+	id_pos_array.push_back(id_pos_array.back() + id_len + 1);
+	out.write(seq.data(), seq.length());
+	out.write("\xff", 1);
+	id_out.write(id, id_len + 1);
+	letters += seq.length();
+	++n_seqs;
+	offset += seq.length() + 1;
+}
+
+struct MakedbBatch
+{
+	MakedbBatch() :
+		n(0)
+	{}
+	unique_ptr<Sequence_set> seqs;
+	unique_ptr<String_set<char, 0>> ids;
+	size_t n;
+	std::exception_ptr error;
+};
+
+static void load_batch(list<TextInputFile> *db_file, MakedbBatch *batch)
+{
+	try {
+		const FASTA_format format;
+		Sequence_set *seqs;
+		String_set<char, 0> *ids;
+		batch->n = load_seqs(db_file->begin(), db_file->end(), format, &seqs, ids, 0, nullptr, (size_t)(1e9), string(), amino_acid_traits);
+		if (batch->n == 0)
+			return;
+		batch->seqs.reset(seqs);
+		batch->ids.reset(ids);
+		for (size_t i = 0; i < batch->n; ++i)
+			if (batch->seqs->length(i) == 0)
+				throw std::runtime_error("File format error: sequence of length 0 at line " + to_string(db_file->front().line_count));
+	}
+	catch (...) {
+		batch->error = std::current_exception();
+	}
+}
+
+static void hash_seqs(const Sequence_set *seqs, const String_set<char, 0> *ids, char *hash)
+{
+	for (size_t i = 0; i < seqs->get_length(); ++i) {
+		sequence seq = (*seqs)[i];
+		MurmurHash3_x64_128(seq.data(), (int)seq.length(), hash, hash);
+		MurmurHash3_x64_128((*ids)[i], ids->length(i), hash, hash);
+	}
+}
+
+static const size_t ACCESSION_CHUNK_SIZE = 4096;
+
+static void extract_accessions(size_t chunk, size_t thread_id, const String_set<char, 0> *ids, vector<vector<string>> *accessions)
+{
+	const size_t end = std::min((chunk + 1) * ACCESSION_CHUNK_SIZE, ids->get_length());
+	for (size_t i = chunk * ACCESSION_CHUNK_SIZE; i < end; ++i)
+		(*accessions)[i] = Taxonomy::Accession::from_title((*ids)[i]);
+}
+
+static void write_padding(OutputFile &out, char c) {
+	const vector<char> padding(Sequence_set::PERIMETER_PADDING, c);
+	out.write(padding.data(), padding.size());
+}
+
+// Second pass over the sequences written to the database file. Estimating the work after all batches have been
+// added to the sketch makes the estimates independent of the position of a sequence in the input file.
+static void estimate_work(OutputFile &out, const WorkSketch &sketch, vector<Pos_record> &pos_array)
+{
+	static const size_t BATCH_LETTERS = (size_t)1 << 28;
+	out.sync();
+	InputFile in(out.file_name());
+	vector<char> buf;
+	size_t i = 0, pos = 0;
+	while (i < pos_array.size()) {
+		Sequence_set seqs;
+		const size_t begin = i;
+		for (size_t letters = 0; i < pos_array.size() && letters < BATCH_LETTERS; ++i) {
+			const Pos_record &r = pos_array[i];
+			// Sequences are preceded by a delimiter, separating ids are skipped.
+			const size_t skip = r.pos + 1 - pos;
+			buf.resize(std::max(skip, (size_t)r.seq_len));
+			if (in.read(buf.data(), skip) != skip || in.read(buf.data(), r.seq_len) != r.seq_len)
+				throw File_read_exception(in.file_name);
+			pos = r.pos + 1 + r.seq_len;
+			seqs.push_back((const Letter*)buf.data(), (const Letter*)buf.data() + r.seq_len);
+			letters += r.seq_len;
+		}
+		seqs.finish_reserve();
+		vector<uint32_t> work;
+		sketch.estimate(seqs, work);
+		for (size_t j = begin; j < i; ++j)
+			pos_array[j].work = work[j - begin];
+	}
+	in.close();
+}
+
 void make_db(TempFile **tmp_out, list<TextInputFile> *input_file)
 {
 	if (config.input_ref_file.size() > 1)
@@ -213,59 +364,128 @@ void make_db(TempFile **tmp_out, list<TextInputFile> *input_file)
 	ReferenceHeader header;
 	ReferenceHeader2 header2;
 
+	const bool mmap_layout = config.mmap_layout && !tmp_out;
+	if (mmap_layout)
+		header.db_version = ReferenceHeader::MMAP_DB_VERSION;
+
+	if (config.masking == 1) {
+		header2.flags |= ReferenceHeader2::STORED_MASKING;
+		header2.masking_signature = Masking::get().signature();
+	}
+
+	// Work estimates are used to partition databases for multiprocessing, which temporary databases do not support.
+	unique_ptr<WorkSketch> work_sketch;
+	if (config.work_estimates && !tmp_out) {
+		work_sketch.reset(new WorkSketch());
+		header2.flags |= ReferenceHeader2::WORK_ESTIMATES;
+	}
+
 	*out << header;
 	*out << header2;
 
-	size_t letters = 0, n = 0, n_seqs = 0;
-	uint64_t offset = out->tell();
+	if (mmap_layout)
+		write_padding(*out, sequence::DELIMITER);
+
+	size_t letters = 0, n_seqs = 0;
+	uint64_t offset = mmap_layout ? out->tell() - 1 : out->tell();
 
-	Sequence_set *seqs;
-	String_set<char, 0> *ids;
-	const FASTA_format format;
 	vector<Pos_record> pos_array;
+	vector<uint64_t> id_pos_array;
 	FileBackedBuffer accessions;
+	unique_ptr<FileBackedBuffer> id_buffer;
+	if (mmap_layout) {
+		id_buffer.reset(new FileBackedBuffer());
+		id_pos_array.push_back(Sequence_set::PERIMETER_PADDING);
+	}
 
+	MakedbBatch batch, next;
+	std::thread loader(load_batch, db_file, &next);
 	try {
-		while ((timer.go("Loading sequences"), n = load_seqs(db_file->begin(), db_file->end(), format, &seqs, ids, 0, nullptr, (size_t)(1e9), string(), amino_acid_traits)) > 0) {
+		for (;;) {
+			timer.go("Loading sequences");
+			loader.join();
+			batch = std::move(next);
+			next = MakedbBatch();
+			if (batch.error)
+				std::rethrow_exception(batch.error);
+			if (batch.n == 0)
+				break;
+			loader = std::thread(load_batch, db_file, &next);
+
 			if (config.masking == 1) {
 				timer.go("Masking sequences");
-				mask_seqs(*seqs, Masking::get(), false);
+				mask_seqs(*batch.seqs, Masking::get(), false);
 			}
-			timer.go("Writing sequences");
-			for (size_t i = 0; i < n; ++i) {
-				sequence seq = (*seqs)[i];
-				if (seq.length() == 0)
-					throw std::runtime_error("File format error: sequence of length 0 at line " + to_string(db_file->front().line_count));
-				push_seq(seq, (*ids)[i], ids->length(i), offset, pos_array, *out, letters, n_seqs);
+
+			if (work_sketch) {
+				timer.go("Counting k-mers");
+				work_sketch->add(*batch.seqs);
 			}
+
+			vector<vector<string>> batch_accessions;
 			if (!config.prot_accession2taxid.empty()) {
-				timer.go("Writing accessions");
-				for (size_t i = 0; i < n; ++i)
-					accessions << Taxonomy::Accession::from_title((*ids)[i]);
+				timer.go("Extracting accessions");
+				batch_accessions.resize(batch.n);
+				Util::Parallel::scheduled_thread_pool_auto(config.threads_, (batch.n + ACCESSION_CHUNK_SIZE - 1) / ACCESSION_CHUNK_SIZE, extract_accessions, batch.ids.get(), &batch_accessions);
+			}
+
+			timer.go("Writing sequences");
+			std::thread hasher(hash_seqs, batch.seqs.get(), batch.ids.get(), header2.hash);
+			try {
+				for (size_t i = 0; i < batch.n; ++i) {
+					if (mmap_layout)
+						push_seq_mmap_layout((*batch.seqs)[i], (*batch.ids)[i], batch.ids->length(i), offset, pos_array, id_pos_array, *out, *id_buffer, letters, n_seqs);
+					else
+						push_seq((*batch.seqs)[i], (*batch.ids)[i], batch.ids->length(i), offset, pos_array, *out, letters, n_seqs);
+				}
+				for (const vector<string>& a : batch_accessions)
+					accessions << a;
 			}
-			timer.go("Hashing sequences");
-			for (size_t i = 0; i < n; ++i) {
-				sequence seq = (*seqs)[i];
-				MurmurHash3_x64_128(seq.data(), (int)seq.length(), header2.hash, header2.hash);
-				MurmurHash3_x64_128((*ids)[i], ids->length(i), header2.hash, header2.hash);
+			catch (...) {
+				hasher.join();
+				throw;
 			}
-			delete seqs;
-			delete ids;
+			hasher.join();
 		}
 	}
-	catch (std::exception&) {
+	catch (...) {
+		if (loader.joinable())
+			loader.join();
 		out->close();
 		out->remove();
 		throw;
 	}
 
+	if (work_sketch) {
+		timer.go("Estimating search work");
+		estimate_work(*out, *work_sketch, pos_array);
+	}
 	timer.finish();
 
+	if (mmap_layout) {
+		timer.go("Writing titles");
+		write_padding(*out, sequence::DELIMITER);
+		const uint64_t id_offset = out->tell();
+		write_padding(*out, '\0');
+		id_buffer->rewind();
+		vector<char> buf(1 << 20);
+		size_t n;
+		while ((n = id_buffer->read(buf.data(), buf.size())) > 0)
+			out->write(buf.data(), n);
+		write_padding(*out, '\0');
+		id_buffer.reset();
+		for (uint64_t& i : id_pos_array)
+			i += id_offset;
+	}
+
 	timer.go("Writing trailer");
-	header.pos_array_offset = offset;
 	pos_array.emplace_back(offset, 0);
+	header.pos_array_offset = mmap_layout ? out->tell() : offset;
 	for (const Pos_record& r : pos_array)
 		*out << r;
+	if (mmap_layout)
+		for (uint64_t i : id_pos_array)
+			*out << i;
 	timer.finish();
 
 	taxonomy.init();
@@ -317,12 +537,17 @@ size_t DatabaseFile::tell_seq() const {
 }
 
 void DatabaseFile::seek_direct() {
-	seek(sizeof(ReferenceHeader) + sizeof(ReferenceHeader2) + 8);
+	uint64_t header2_size;
+	seek(sizeof(ReferenceHeader));
+	varint = false;
+	*this >> header2_size;
+	seek_forward(header2_size);
+	direct_seq_ = 0;
 }
 
 bool DatabaseFile::load_seqs(vector<uint32_t>* block2db_id, const size_t max_letters, Sequence_set **dst_seq, String_set<char, 0> **dst_id, bool load_ids, const BitVector* filter, const bool fetch_seqs, const Chunk & chunk)
 {
-	task_timer timer("Loading reference sequences");
+	task_timer timer("Loading reference sequences", silent_load ? UINT_MAX : 1);
 
 	if (max_letters > 0) {
 		seek(pos_array_offset);
@@ -332,14 +557,17 @@ bool DatabaseFile::load_seqs(vector<uint32_t>* block2db_id, const size_t max_let
 	}
 
 	size_t database_id = tell_seq();
+	const size_t first_id = database_id;
 	size_t letters = 0, seqs = 0, id_letters = 0, seqs_processed = 0, filtered_seq_count = 0;
 	vector<uint64_t> filtered_pos;
 	vector<bool> filtered_seqs;
+	vector<size_t> selected;
 	if (block2db_id) block2db_id->clear();
 
+	const bool view = fetch_seqs && map_ && config.mmap_db && !filter;
 	if (fetch_seqs) {
-		*dst_seq = new Sequence_set;
-		if(load_ids) *dst_id = new String_set<char, 0>;
+		*dst_seq = view ? nullptr : new Sequence_set;
+		if(load_ids) *dst_id = view ? nullptr : new String_set<char, 0>;
 	}
 
 	Pos_record r;
@@ -360,14 +588,16 @@ bool DatabaseFile::load_seqs(vector<uint32_t>* block2db_id, const size_t max_let
 		(*this) >> r_next;
 		if (!filter || filter->get(database_id)) {
 			letters += r.seq_len;
-			if (fetch_seqs) {
+			if (fetch_seqs && !view) {
 				(*dst_seq)->reserve(r.seq_len);
 			}
-			const size_t id_len = r_next.pos - r.pos - r.seq_len - 3;
+			const size_t id_len = map_ ? id_pos(database_id + 1) - id_pos(database_id) - 1 : r_next.pos - r.pos - r.seq_len - 3;
 			id_letters += id_len;
-			if (fetch_seqs) {
+			if (fetch_seqs && !view) {
 				if (load_ids) (*dst_id)->reserve(id_len);
 			}
+			if (map_)
+				selected.push_back(database_id);
 			//++seqs;
 			++filtered_seq_count;
 			if (block2db_id) block2db_id->push_back((unsigned)database_id);
@@ -399,7 +629,27 @@ bool DatabaseFile::load_seqs(vector<uint32_t>* block2db_id, const size_t max_let
 		return false;
 	}
 
-	if (fetch_seqs) {
+	size_t masked = 0;
+	if (view) {
+		load_view(first_id, filtered_seq_count, dst_seq, load_ids ? dst_id : nullptr, masked);
+		timer.finish();
+		if (!silent_load)
+			(*dst_seq)->print_stats();
+	}
+	else if (fetch_seqs && map_) {
+		(*dst_seq)->finish_reserve();
+		if (load_ids) (*dst_id)->finish_reserve();
+		for (size_t i = 0; i < filtered_seq_count; ++i) {
+			memcpy((*dst_seq)->ptr(i) - 1, map_ + seq_pos(selected[i]), (*dst_seq)->length(i) + 2);
+			if (load_ids)
+				memcpy((*dst_id)->ptr(i), map_ + id_pos(selected[i]), (*dst_id)->length(i) + 1);
+			unpack_masking((*dst_seq)->ptr(i), (*dst_seq)->length(i), masked);
+		}
+		timer.finish();
+		if (!silent_load)
+			(*dst_seq)->print_stats();
+	}
+	else if (fetch_seqs) {
 		(*dst_seq)->finish_reserve();
 		if(load_ids) (*dst_id)->finish_reserve();
 		seek(start_offset);
@@ -417,11 +667,14 @@ bool DatabaseFile::load_seqs(vector<uint32_t>* block2db_id, const size_t max_let
 				read((*dst_id)->ptr(i), (*dst_id)->length(i) + 1);
 			else
 				if (!seek_forward('\0')) throw std::runtime_error("Unexpected end of file.");
-			Masking::get().remove_bit_mask((*dst_seq)->ptr(i), (*dst_seq)->length(i));
+			unpack_masking((*dst_seq)->ptr(i), (*dst_seq)->length(i), masked);
 		}
 		timer.finish();
-		(*dst_seq)->print_stats();
+		if (!silent_load)
+			(*dst_seq)->print_stats();
 	}
+	if (fetch_seqs && load_masked && !silent_load)
+		log_stream << "Masked letters: " << masked << endl;
 
 	if (config.multiprocessing || config.global_ranking_targets)
 		blocked_processing = true;
@@ -431,8 +684,43 @@ bool DatabaseFile::load_seqs(vector<uint32_t>* block2db_id, const size_t max_let
 	return true;
 }
 
+void DatabaseFile::load_view(size_t first_id, size_t n, Sequence_set **dst_seq, String_set<char, 0> **dst_id, size_t &masked)
+{
+	const size_t padding = Sequence_set::PERIMETER_PADDING;
+	const uint64_t seq_begin = seq_pos(first_id) + 1 - padding, seq_end = seq_pos(first_id + n) + 1 + padding;
+	vector<size_t> limits;
+	limits.reserve(n + 1);
+	for (size_t i = 0; i <= n; ++i)
+		limits.push_back(seq_pos(first_id + i) + 1 - seq_begin);
+	size_t map_size;
+	char* map = mmap_file_range(file_name.c_str(), seq_begin, seq_end - seq_begin, map_size);
+	if (map == nullptr)
+		throw std::runtime_error("Error mapping database file: " + file_name);
+	*dst_seq = new Sequence_set((Letter*)map, std::move(limits), map, map_size);
+	for (size_t i = 0; i < n; ++i)
+		unpack_masking((*dst_seq)->ptr(i), (*dst_seq)->length(i), masked);
+
+	if (!dst_id)
+		return;
+	const uint64_t id_begin = id_pos(first_id) - padding, id_end = id_pos(first_id + n) + padding;
+	limits.clear();
+	for (size_t i = 0; i <= n; ++i)
+		limits.push_back(id_pos(first_id + i) - id_begin);
+	map = mmap_file_range(file_name.c_str(), id_begin, id_end - id_begin, map_size);
+	if (map == nullptr)
+		throw std::runtime_error("Error mapping database file: " + file_name);
+	*dst_id = new String_set<char, 0>(map, std::move(limits), map, map_size);
+}
+
 void DatabaseFile::read_seq(string &id, vector<Letter> &seq)
 {
+	if (map_) {
+		const char* p = map_ + seq_pos(direct_seq_) + 1;
+		seq.assign(p, p + (seq_pos(direct_seq_ + 1) - seq_pos(direct_seq_) - 1));
+		id.assign(map_ + id_pos(direct_seq_));
+		++direct_seq_;
+		return;
+	}
 	char c;
 	read(&c, 1);
 	seq.clear();
@@ -443,6 +731,10 @@ void DatabaseFile::read_seq(string &id, vector<Letter> &seq)
 
 void DatabaseFile::skip_seq()
 {
+	if (map_) {
+		++direct_seq_;
+		return;
+	}
 	char c;
 	if(read(&c, 1) != 1)
 		throw std::runtime_error("Unexpected end of file.");
@@ -514,6 +806,10 @@ void db_info()
 	cout << "Diamond build = " << header.build << endl;
 	cout << "Sequences = " << header.sequences << endl;
 	cout << "Letters = " << header.letters << endl;
+	ReferenceHeader2 header2;
+	db_file >> header2;
+	cout << "Stored masking = " << ((header2.flags & ReferenceHeader2::STORED_MASKING) ? "yes" : "no") << endl;
+	cout << "Work estimates = " << ((header2.flags & ReferenceHeader2::WORK_ESTIMATES) ? "yes" : "no") << endl;
 	db_file.close();
 }
 
@@ -553,14 +849,34 @@ void DatabaseFile::create_partition_fixednumber(size_t n) {
 
 void DatabaseFile::create_partition_balanced(size_t max_letters) {
 	double n = std::ceil(static_cast<double>(ref_header.letters) / static_cast<double>(max_letters));
+	if (has_work_estimates()) {
+		const uint64_t max_work = static_cast<uint64_t>(std::ceil(static_cast<double>(total_work()) / n));
+		cout << "Work balanced partitioning using " << max_work << " (" << max_letters << ")" << endl;
+		this->create_partition(max_letters, max_work);
+		return;
+	}
 	size_t max_letters_balanced = static_cast<size_t>(std::ceil(static_cast<double>(ref_header.letters)/n));
 	cout << "Balanced partitioning using " << max_letters_balanced << " (" << max_letters << ")" << endl;
 	this->create_partition(max_letters_balanced);
 }
 
-void DatabaseFile::create_partition(size_t max_letters) {
+uint64_t DatabaseFile::total_work() {
+	uint64_t work = 0;
+	rewind();
+	seek(pos_array_offset);
+	Pos_record r;
+	read(&r, 1);
+	while (r.seq_len) {
+		work += r.work;
+		read(&r, 1);
+	}
+	return work;
+}
+
+void DatabaseFile::create_partition(size_t max_letters, uint64_t max_work) {
 	task_timer timer("Create partition of DatabaseFile");
 	size_t letters = 0, seqs = 0, total_seqs = 0;
+	uint64_t work = 0;
 	size_t i_chunk = 0;
 
 	rewind();
@@ -577,14 +893,16 @@ void DatabaseFile::create_partition(size_t max_letters) {
 			first = false;
 		}
 		letters += r.seq_len;
+		work += r.work;
 		++seqs;
 		++total_seqs;
 		read(&r_next, 1);
-		if ((letters > max_letters) || (r_next.seq_len == 0)) {
+		if ((letters > max_letters) || (max_work > 0 && work >= max_work) || (r_next.seq_len == 0)) {
 			partition.chunks.push_back(Chunk(i_chunk, pos, seqs));
 			first = true;
 			seqs = 0;
 			letters = 0;
+			work = 0;
 			++i_chunk;
 		}
 		pos_array_offset += sizeof(Pos_record);
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/io/input_file.h"
 #include "../util/io/text_input_file.h"
 #include "../data/seed_histogram.h"
+#include "seed_set.h"
 #include "sequence_set.h"
 #include "metadata.h"
 #include "../util/data_structures/bit_vector.h"
@@ -47,7 +48,7 @@ struct ReferenceHeader
 	uint64_t magic_number;
 	uint32_t build, db_version;
 	uint64_t sequences, letters, pos_array_offset;
-	enum { current_db_version = 3 };
+	enum { current_db_version = 3, MMAP_DB_VERSION = 4 };
 	static constexpr uint64_t MAGIC_NUMBER = 0x24af8a415ee186dllu;
 	friend InputFile& operator>>(InputFile& file, ReferenceHeader& h);
 };
@@ -58,12 +59,15 @@ struct ReferenceHeader2
 		taxon_array_offset(0),
 		taxon_array_size(0),
 		taxon_nodes_offset(0),
-		taxon_names_offset(0)
+		taxon_names_offset(0),
+		flags(0),
+		masking_signature(0)
 	{
 		memset(hash, 0, sizeof(hash));
 	}
 	char hash[16];
-	uint64_t taxon_array_offset, taxon_array_size, taxon_nodes_offset, taxon_names_offset;
+	uint64_t taxon_array_offset, taxon_array_size, taxon_nodes_offset, taxon_names_offset, flags, masking_signature;
+	enum { STORED_MASKING = 1, WORK_ESTIMATES = 2 };
 
 	friend Serializer& operator<<(Serializer &s, const ReferenceHeader2 &h);
 	friend Deserializer& operator>>(Deserializer &d, ReferenceHeader2 &h);
@@ -98,7 +102,8 @@ struct DatabaseFile : public InputFile
 	static bool is_diamond_db(const string &file_name);
 	void rewind();
 
-	void create_partition(size_t max_letters);
+	void create_partition(size_t max_letters, uint64_t max_work = 0);
+	// Balances the predicted search work of the chunks if the database stores work estimates, otherwise the letters.
 	void create_partition_balanced(size_t max_letters);
 	void create_partition_fixednumber(size_t n);
 
@@ -120,10 +125,18 @@ struct DatabaseFile : public InputFile
 	size_t tell_seq() const;
 	void seek_direct();
 	size_t total_blocks() const;
+	bool mmap_layout() const;
+	bool has_stored_masking() const;
+	bool has_work_estimates() const;
+	uint64_t total_work();
 
 	enum { min_build_required = 74, MIN_DB_VERSION = 2 };
 
 	bool temporary;
+	// Hard mask loaded sequences using the masking bits stored by makedb.
+	bool load_masked;
+	// Suppress the progress messages of load_seqs, e.g. when loading in the background.
+	bool silent_load;
 	size_t pos_array_offset;
 	ReferenceHeader ref_header;
 	ReferenceHeader2 header2;
@@ -141,6 +154,17 @@ struct DatabaseFile : public InputFile
 
 private:
 	void init();
+	uint64_t seq_pos(size_t i) const;
+	uint64_t id_pos(size_t i) const;
+	void load_view(size_t first_id, size_t n, Sequence_set **dst_seq, String_set<char, 0> **dst_id, size_t &masked);
+	void unpack_masking(Letter *seq, size_t len, size_t &masked) const;
+
+	// Read-only mapping of databases in the mmap layout (db_version 4), which store all
+	// sequences followed by all titles, each region padded like a String_set.
+	char* map_;
+	size_t map_size_;
+	int map_fd_;
+	size_t direct_seq_;
 
 };
 
@@ -176,6 +200,7 @@ struct ref_ids
 };
 
 extern Partitioned_histogram ref_hst;
+extern Seed_sketch *ref_sketch;
 extern unsigned current_ref_block;
 extern bool blocked_processing;
 extern std::vector<uint32_t> block_to_database_id;
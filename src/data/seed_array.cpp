@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "seed_set.h"
 #include "enum_seeds.h"
 #include "../util/data_structures/deque.h"
+#include "seed_index.h"
+#include "../util/parallel/node_queue.h"
 
 using std::array;
 
@@ -28,9 +30,25 @@ typedef vector<Array<SeedArray::Entry*, Const::seedp>> PtrSet;
 
 char* SeedArray::alloc_buffer(const Partitioned_histogram &hst)
 {
+	if (Util::Parallel::ThreadPool::get().node_count() > 1)
+		return nullptr;
 	return new char[sizeof(Entry) * hst.max_chunk_size()];
 }
 
+// Touches the pages of each seed partition from a worker of the NUMA node that will process it,
+// so that the first touch policy of the OS places them in the memory of that node.
+static void first_touch(char* data, const size_t* begin, const SeedPartitionRange& range)
+{
+	const size_t PAGE_SIZE = 4096;
+	Util::Parallel::NodeLocalQueue queue(range.begin(), range.end());
+	Util::Parallel::run_tasks(config.threads_, [&](size_t) {
+		size_t p;
+		while ((p = queue.next()) < queue.end())
+			for (char* ptr = data + begin[p] * sizeof(SeedArray::Entry); ptr < data + begin[p + 1] * sizeof(SeedArray::Entry); ptr += PAGE_SIZE)
+				*ptr = 0;
+	});
+}
+
 struct BufferedWriter
 {
 	static const unsigned BUFFER_SIZE = 16;
@@ -102,11 +120,17 @@ struct BuildCallback
 
 template<typename _filter>
 SeedArray::SeedArray(const Sequence_set &seqs, size_t shape, const shape_histogram &hst, const SeedPartitionRange &range, const vector<size_t> &seq_partition, char *buffer, const _filter *filter) :
-	data_((Entry*)buffer)
+	data_((Entry*)buffer),
+	own_buffer_(nullptr)
 {
 	begin_[range.begin()] = 0;
 	for (size_t i = range.begin(); i < range.end(); ++i)
 		begin_[i + 1] = begin_[i] + partition_size(hst, i);
+	if (buffer == nullptr) {
+		own_buffer_ = new char[sizeof(Entry) * begin_[range.end()]];
+		data_ = (Entry*)own_buffer_;
+		first_touch(own_buffer_, begin_, range);
+	}
 
 	PtrSet iterators(build_iterators(*this, hst));
 	PtrVector<BuildCallback> cb;
@@ -118,6 +142,9 @@ SeedArray::SeedArray(const Sequence_set &seqs, size_t shape, const shape_histogr
 template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const No_filter *);
 template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Seed_set *);
 template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Hashed_seed_set *);
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Seed_sketch *);
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Minimizer_filter<No_filter> *);
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Minimizer_filter<Seed_sketch> *);
 
 struct BufferedWriter2
 {
@@ -177,7 +204,8 @@ struct BuildCallback2
 
 template<typename _filter>
 SeedArray::SeedArray(const Sequence_set& seqs, size_t shape, const SeedPartitionRange& range, const _filter* filter) :
-	data_(nullptr)
+	data_(nullptr),
+	own_buffer_(nullptr)
 {
 	const auto seq_partition = seqs.partition(config.threads_);
 	PtrVector<BuildCallback2> cb;
@@ -198,4 +226,18 @@ SeedArray::SeedArray(const Sequence_set& seqs, size_t shape, const SeedPartition
 	}
 }
 
-template SeedArray::SeedArray(const Sequence_set&, size_t, const SeedPartitionRange&, const Hashed_seed_set*);
\ No newline at end of file
+template SeedArray::SeedArray(const Sequence_set&, size_t, const SeedPartitionRange&, const Hashed_seed_set*);
+
+SeedArray::SeedArray(const SeedIndex::File& index_file) :
+	data_((Entry*)index_file.entries()),
+	own_buffer_(nullptr)
+{
+	const uint64_t* begin = index_file.partition_begin();
+	for (unsigned i = 0; i <= Const::seedp; ++i)
+		begin_[i] = (size_t)begin[i];
+}
+
+SeedArray::~SeedArray()
+{
+	delete[] own_buffer_;
+}
\ No newline at end of file
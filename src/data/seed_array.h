@@ -19,9 +19,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 #include <array>
 #include <vector>
+#include <string>
 #include "seed_histogram.h"
 #include "../basic/packed_loc.h"
 
+namespace SeedIndex { struct File; }
+
 #pragma pack(1)
 
 struct SeedArray
@@ -56,6 +59,10 @@ struct SeedArray
 	template<typename _filter>
 	SeedArray(const Sequence_set& seqs, size_t shape, const SeedPartitionRange& range, const _filter* filter);
 
+	// Refers to the entries of a mapped seed index file, which has to outlive the array.
+	SeedArray(const SeedIndex::File& index_file);
+	~SeedArray();
+
 	Entry* begin(unsigned i)
 	{
 		if (data_)
@@ -92,11 +99,13 @@ struct SeedArray
 		}
 	}
 
+	// Returns nullptr in NUMA mode, where every seed array allocates its own buffer.
 	static char *alloc_buffer(const Partitioned_histogram &hst);
 
 private:
 
 	Entry *data_;
+	char* own_buffer_;
 	size_t begin_[Const::seedp + 1];
 	std::array<std::vector<Entry>, Const::seedp> entries_;
 
@@ -0,0 +1,188 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include "seed_index.h"
+#include "reference.h"
+#include "seed_array.h"
+#include "../basic/config.h"
+#include "../basic/masking.h"
+#include "../basic/shape_config.h"
+#include "../basic/reduction.h"
+#include "../search/search.h"
+#include "../util/io/input_file.h"
+#include "../util/io/output_file.h"
+#include "../util/log_stream.h"
+#include "../util/system/system.h"
+
+using std::string;
+using std::vector;
+using std::endl;
+
+namespace SeedIndex {
+
+static bool ref_masking() {
+	return config.masking == 1 && !config.no_ref_masking;
+}
+
+File::File(const string& file_name)
+{
+	auto f = mmap_file(file_name.c_str(), true);
+	map_ = std::get<0>(f);
+	size_ = std::get<1>(f);
+	fd_ = std::get<2>(f);
+	const size_t offsets = sizeof(SeedIndexHeader) + (Const::seedp + 1) * sizeof(uint64_t);
+	if (size_ < offsets || size_ < offsets + header().entries * sizeof(SeedArray::Entry) || partition_begin()[Const::seedp] != header().entries)
+		throw std::runtime_error("Seed index file is truncated: " + file_name);
+}
+
+File::~File()
+{
+	unmap_file(map_, size_, fd_);
+}
+
+string file_name(size_t block, unsigned shape) {
+	return config.database + ".seedidx." + std::to_string(block) + '.' + std::to_string(shape);
+}
+
+SeedIndexHeader header(const DatabaseFile& db_file, const vector<uint32_t>& block2db_id, const Sequence_set& seqs, unsigned shape) {
+	SeedIndexHeader h;
+	memcpy(h.db_hash, db_file.header2.hash, sizeof(h.db_hash));
+	h.first_seq = block2db_id.empty() ? 0 : block2db_id.front();
+	h.seqs = seqs.get_length();
+	h.letters = seqs.letters();
+	h.raw_len = seqs.raw_len();
+	h.sensitivity = (uint32_t)config.sensitivity;
+	h.shape_count = shapes.count();
+	for (size_t i = 0; i < TRUE_AA; ++i)
+		h.reduction[i] = (uint8_t)Reduction::reduction((Letter)i);
+	h.shape_mask = shapes[shape].mask_;
+	h.shape_length = shapes[shape].length_;
+	h.flags = (ref_masking() ? SeedIndexHeader::MASKED : 0) | (config.hashed_seeds ? SeedIndexHeader::HASHED_SEEDS : 0);
+	return h;
+}
+
+static bool matches(const SeedIndexHeader& expected, const SeedIndexHeader& h) {
+	return h.magic_number == expected.magic_number
+		&& h.version == expected.version
+		&& memcmp(h.db_hash, expected.db_hash, sizeof(h.db_hash)) == 0
+		&& h.first_seq == expected.first_seq
+		&& h.seqs == expected.seqs
+		&& h.letters == expected.letters
+		&& h.raw_len == expected.raw_len
+		&& h.sensitivity == expected.sensitivity
+		&& h.shape_count == expected.shape_count
+		&& memcmp(h.reduction, expected.reduction, sizeof(h.reduction)) == 0
+		&& h.shape_mask == expected.shape_mask
+		&& h.shape_length == expected.shape_length
+		&& h.flags == expected.flags;
+}
+
+bool available(const DatabaseFile& db_file, size_t block, const vector<uint32_t>& block2db_id, const Sequence_set& seqs) {
+	for (unsigned i = 0; i < shapes.count(); ++i) {
+		const string name = file_name(block, i);
+		if (!exists(name))
+			return false;
+		InputFile f(name);
+		SeedIndexHeader h;
+		const size_t n = f.read(&h, 1);
+		f.close();
+		if (n != 1 || !matches(header(db_file, block2db_id, seqs, i), h)) {
+			log_stream << "Seed index file " << name << " does not match the current reference block." << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+void make_seed_index()
+{
+	task_timer timer("Opening the database", 1);
+	DatabaseFile db_file(config.database);
+	timer.finish();
+	make_seed_index(db_file);
+}
+
+void make_seed_index(DatabaseFile& db_file)
+{
+	task_timer total;
+	task_timer timer;
+	if (config.sensitivity >= Sensitivity::VERY_SENSITIVE)
+		Config::set_option(config.chunk_size, 0.4);
+	else
+		Config::set_option(config.chunk_size, 2.0);
+	config.algo = Config::double_indexed;
+	setup_search();
+
+	message_stream << "Reference = " << config.database << endl;
+	message_stream << "Sequences = " << db_file.ref_header.sequences << endl;
+	message_stream << "Letters = " << db_file.ref_header.letters << endl;
+	message_stream << "Block size = " << (size_t)(config.chunk_size * 1e9) << endl;
+
+	db_file.load_masked = SeedIndex::ref_masking() && db_file.has_stored_masking();
+	db_file.rewind();
+	size_t entries = 0;
+	for (current_ref_block = 0;
+		db_file.load_seqs(&block_to_database_id, (size_t)(config.chunk_size * 1e9), &ref_seqs::data_, &ref_ids::data_, false);
+		++current_ref_block) {
+		if (SeedIndex::ref_masking() && !db_file.load_masked) {
+			timer.go("Masking reference");
+			size_t n = mask_seqs(*ref_seqs::data_, Masking::get());
+			timer.finish();
+			log_stream << "Masked letters: " << n << endl;
+		}
+
+		timer.go("Building reference histograms");
+		const Partitioned_histogram hst(*ref_seqs::data_, false, &no_filter);
+
+		for (unsigned sid = 0; sid < shapes.count(); ++sid) {
+			timer.go("Building reference seed array");
+			const SeedPartitionRange range = SeedPartitionRange::all();
+			char* buffer = new char[sizeof(SeedArray::Entry) * hst_size(hst.get(sid), range)];
+			SeedArray* idx = new SeedArray(*ref_seqs::data_, sid, hst.get(sid), range, hst.partition(), buffer, &no_filter);
+
+			timer.go("Writing seed index");
+			SeedIndexHeader h = SeedIndex::header(db_file, block_to_database_id, *ref_seqs::data_, sid);
+			h.entries = idx->size();
+			vector<uint64_t> begin(Const::seedp + 1, 0);
+			for (unsigned p = 0; p < Const::seedp; ++p)
+				begin[p + 1] = begin[p] + idx->size(p);
+			OutputFile out(SeedIndex::file_name(current_ref_block, sid));
+			out.write(&h, 1);
+			out.write(begin.data(), begin.size());
+			out.write(idx->begin(0), h.entries);
+			out.close();
+			entries += h.entries;
+
+			delete idx;
+			delete[] buffer;
+		}
+
+		timer.go("Deallocating reference");
+		delete ref_seqs::data_;
+		timer.finish();
+	}
+
+	message_stream << "Wrote seed index for " << current_ref_block << " blocks, " << shapes.count() << " shapes, " << entries << " seeds." << endl;
+	message_stream << "Total time = " << total.get() << "s" << endl;
+}
@@ -0,0 +1,107 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include "../basic/const.h"
+#include "sequence_set.h"
+
+struct DatabaseFile;
+
+// Header of a persisted reference seed array. One file is written per
+// reference block and shape, followed by the Const::seedp + 1 partition
+// offsets and the SeedArray entries of all seed partitions. The reduced
+// alphabet, sensitivity and shape set are stored to reject an index that
+// was built for different search settings.
+struct SeedIndexHeader
+{
+	SeedIndexHeader() :
+		magic_number(MAGIC_NUMBER),
+		build(Const::build_version),
+		version(CURRENT_VERSION),
+		first_seq(0),
+		seqs(0),
+		letters(0),
+		raw_len(0),
+		sensitivity(0),
+		shape_count(0),
+		shape_mask(0),
+		shape_length(0),
+		flags(0),
+		entries(0)
+	{
+		memset(db_hash, 0, sizeof(db_hash));
+		memset(reduction, 0, sizeof(reduction));
+	}
+	uint64_t magic_number;
+	uint32_t build, version;
+	char db_hash[16];
+	uint64_t first_seq, seqs, letters, raw_len;
+	uint32_t sensitivity, shape_count, shape_mask, shape_length, flags;
+	// Reduced letter of each amino acid.
+	uint8_t reduction[TRUE_AA];
+	uint64_t entries;
+	enum { CURRENT_VERSION = 1 };
+	enum { MASKED = 1, HASHED_SEEDS = 2 };
+	static constexpr uint64_t MAGIC_NUMBER = 0x3c0e4a8d7f21b96bllu;
+};
+
+namespace SeedIndex {
+
+// Memory mapping of a seed index file. It is shared by the seed arrays of all
+// index chunks of the shape.
+struct File
+{
+	File(const std::string& file_name);
+	~File();
+	File(const File&) = delete;
+	File& operator=(const File&) = delete;
+	const SeedIndexHeader& header() const
+	{
+		return *(const SeedIndexHeader*)map_;
+	}
+	// Offsets of the seed partitions, Const::seedp + 1 values.
+	const uint64_t* partition_begin() const
+	{
+		return (const uint64_t*)(map_ + sizeof(SeedIndexHeader));
+	}
+	char* entries() const
+	{
+		return (char*)(partition_begin() + Const::seedp + 1);
+	}
+private:
+	char* map_;
+	size_t size_;
+	int fd_;
+};
+
+std::string file_name(size_t block, unsigned shape);
+SeedIndexHeader header(const DatabaseFile& db_file, const std::vector<uint32_t>& block2db_id, const Sequence_set& seqs, unsigned shape);
+bool available(const DatabaseFile& db_file, size_t block, const std::vector<uint32_t>& block2db_id, const Sequence_set& seqs);
+
+}
+
+void make_seed_index();
+void make_seed_index(DatabaseFile& db_file);
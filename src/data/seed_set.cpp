@@ -137,4 +137,84 @@ Hashed_seed_set::~Hashed_seed_set() {
 		unmap_file((char*)data_[i].table, data_[i].size(), fd_[i]);
 		data_[i].table = nullptr;
 	}
-}
\ No newline at end of file
+}
+struct Seed_sketch_callback
+{
+	Seed_sketch_callback(Seed_sketch &sketch):
+		sketch(sketch)
+	{}
+	bool operator()(uint64_t seed, uint64_t pos, uint64_t shape)
+	{
+		sketch.add(seed, shape);
+		return true;
+	}
+	void finish()
+	{}
+	Seed_sketch &sketch;
+};
+
+// Limit on the total number of counters of a sketch (512 MB), and on the average number of seeds per counter up to
+// which the frequency estimates are used.
+static const size_t SKETCH_MAX_COUNTERS = (size_t)1 << 28;
+static const double SKETCH_LOAD_LIMIT = 1.0;
+
+static size_t sketch_width(size_t letters, unsigned depth)
+{
+	size_t max_width = (size_t)1 << 16;
+	if (config.sketch_width > 0)
+		max_width = (size_t)next_power_of_2((double)config.sketch_width);
+	else
+		while (max_width * 2 * depth * shapes.count() <= SKETCH_MAX_COUNTERS)
+			max_width *= 2;
+	return std::min(std::max((size_t)next_power_of_2(letters * 2), (size_t)1 << 16), max_width);
+}
+
+Seed_sketch::Seed_sketch(const Sequence_set &seqs, double sd_factor):
+	width_(sketch_width(seqs.letters(), DEPTH))
+{
+	for (size_t i = 0; i < shapes.count(); ++i) {
+		data_.emplace_back(new std::atomic<uint16_t>[DEPTH * width_]);
+		for (size_t j = 0; j < DEPTH * width_; ++j)
+			data_.back()[j].store(0, std::memory_order_relaxed);
+	}
+	const vector<size_t> p = seqs.partition(config.threads_);
+	PtrVector<Seed_sketch_callback> v;
+	for (size_t i = 0; i < p.size() - 1; ++i)
+		v.push_back(new Seed_sketch_callback(*this));
+	enum_seeds(&seqs, v, p, 0, shapes.count(), &no_filter);
+
+	// The moments of the seed frequencies are estimated from the first row. The number of distinct seeds is derived
+	// from the fraction of empty counters (linear counting), the sum of squared frequencies is corrected for the
+	// expected contribution of hash collisions. Above the load limit, collisions dominate the counts and the shape
+	// is not filtered.
+	unsigned disabled = 0;
+	for (size_t i = 0; i < shapes.count(); ++i) {
+		double n = 0.0, sq = 0.0;
+		size_t zero = 0;
+		for (size_t j = 0; j < width_; ++j) {
+			const double c = data_[i][j].load(std::memory_order_relaxed);
+			n += c;
+			sq += c * c;
+			if (c == 0.0)
+				++zero;
+		}
+		const double w = (double)width_, load = n / w;
+		if (load > SKETCH_LOAD_LIMIT || zero == 0) {
+			cap_.push_back(UINT16_MAX);
+			noise_.push_back(0);
+			++disabled;
+			log_stream << "Seed sketch shape=" << i << " seeds=" << n << " width=" << width_ << " load=" << load << " disabled" << endl;
+			continue;
+		}
+		const double distinct = std::max(w * log(w / zero), 1.0),
+			f2 = std::max((w * sq - n * n) / (w - 1), n),
+			mean = n / distinct,
+			sd = sqrt(std::max(f2 / distinct - mean * mean, 0.0));
+		cap_.push_back((unsigned)std::min(mean + sd_factor * sd, (double)UINT16_MAX - 1));
+		noise_.push_back((unsigned)load);
+		log_stream << "Seed sketch shape=" << i << " seeds=" << n << " width=" << width_ << " load=" << load << " distinct=" << distinct << " mean=" << mean << " SD=" << sd << " cap=" << cap_.back() << endl;
+	}
+	if (disabled > 0)
+		message_stream << "WARNING: The seed sketch of " << seqs.letters() << " letters is too small to estimate seed frequencies, the seed filter is disabled for "
+			<< disabled << '/' << shapes.count() << " shapes." << endl;
+}
@@ -18,9 +18,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
 #include "sequence_set.h"
 #include "../util/hash_table.h"
 #include "../util/ptr_vector.h"
+#include "../util/hash_function.h"
 
 struct Seed_set
 {
@@ -50,3 +55,40 @@ private:
 	PtrVector<PHash_set<Modulo2, No_hash>> data_;
 	std::vector<int> fd_;
 };
+
+// Count-min sketch of the seed frequencies of a sequence set per shape. Used as a seed filter that drops the seeds
+// whose estimated frequency exceeds mean + sd_factor * SD of the frequencies of the distinct seeds, so that
+// they do not enter the seed arrays and the hash join. The width grows with the number of letters up to a memory
+// limit. Beyond that, shapes whose counters hold more than one seed on average are not filtered.
+struct Seed_sketch
+{
+	Seed_sketch(const Sequence_set &seqs, double sd_factor);
+	void add(uint64_t key, uint64_t shape)
+	{
+		const uint64_t h = murmur_hash()(key);
+		for (unsigned i = 0; i < DEPTH; ++i) {
+			std::atomic<uint16_t> &c = data_[shape][i * width_ + ((h >> (i * 32)) & (width_ - 1))];
+			uint16_t n = c.load(std::memory_order_relaxed);
+			while (n < UINT16_MAX && !c.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+		}
+	}
+	unsigned count(uint64_t key, uint64_t shape) const
+	{
+		const uint64_t h = murmur_hash()(key);
+		unsigned n = UINT16_MAX;
+		for (unsigned i = 0; i < DEPTH; ++i)
+			n = std::min(n, (unsigned)data_[shape][i * width_ + ((h >> (i * 32)) & (width_ - 1))].load(std::memory_order_relaxed));
+		return n;
+	}
+	// The count is corrected for the expected number of colliding seeds per counter.
+	bool contains(uint64_t key, uint64_t shape) const
+	{
+		const unsigned n = count(key, shape);
+		return n <= noise_[shape] || n - noise_[shape] <= cap_[shape];
+	}
+private:
+	enum { DEPTH = 2 };
+	size_t width_;
+	std::vector<std::unique_ptr<std::atomic<uint16_t>[]>> data_;
+	std::vector<unsigned> cap_, noise_;
+};
@@ -0,0 +1,127 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include "seq_work.h"
+#include "../basic/config.h"
+#include "../util/hash_function.h"
+#include "../util/parallel/thread_pool.h"
+
+using std::vector;
+
+static const uint64_t KEY_MODULUS = 1280000000llu; // TRUE_AA^K
+static const size_t CHUNK_SIZE = 4096;
+
+// Calls f with the key of each window of K amino acids. Masked letters carry the masking bit and are negative.
+template<typename _f>
+static void for_each_window(const Letter *seq, size_t len, _f f)
+{
+	uint64_t key = 0;
+	size_t n = 0;
+	for (size_t i = 0; i < len; ++i) {
+		const Letter l = seq[i];
+		if (l < 0 || (size_t)l >= TRUE_AA) {
+			n = 0;
+			continue;
+		}
+		key = (key * TRUE_AA + l) % KEY_MODULUS;
+		if (++n >= WorkSketch::K)
+			f(key);
+	}
+}
+
+WorkSketch::WorkSketch():
+	data_(new std::atomic<uint16_t>[DEPTH << WIDTH_BITS]),
+	total_(0)
+{
+	for (size_t i = 0; i < ((size_t)DEPTH << WIDTH_BITS); ++i)
+		data_[i].store(0, std::memory_order_relaxed);
+}
+
+void WorkSketch::add(const Letter *seq, size_t len)
+{
+	uint64_t n = 0;
+	for_each_window(seq, len, [this, &n](uint64_t key) {
+		const uint64_t h = murmur_hash()(key);
+		if (h & (SAMPLING - 1))
+			return;
+		for (unsigned i = 0; i < DEPTH; ++i) {
+			std::atomic<uint16_t> &c = data_[((size_t)i << WIDTH_BITS) + index(h, i)];
+			uint16_t x = c.load(std::memory_order_relaxed);
+			while (x < UINT16_MAX && !c.compare_exchange_weak(x, x + 1, std::memory_order_relaxed));
+		}
+		++n;
+	});
+	total_ += n;
+}
+
+unsigned WorkSketch::count(uint64_t h) const
+{
+	unsigned n = UINT16_MAX;
+	for (unsigned i = 0; i < DEPTH; ++i)
+		n = std::min(n, (unsigned)data_[((size_t)i << WIDTH_BITS) + index(h, i)].load(std::memory_order_relaxed));
+	return n;
+}
+
+uint32_t WorkSketch::work(const Letter *seq, size_t len) const
+{
+	// Counts are corrected for the expected number of colliding k-mers per counter. They are only bounded by the
+	// saturation of the counters, so that highly repetitive sequences keep their weight.
+	const unsigned noise = (unsigned)std::min(total_.load() >> WIDTH_BITS, (uint64_t)UINT16_MAX);
+	uint64_t windows = 0, sampled = 0, freq = 0;
+	for_each_window(seq, len, [&](uint64_t key) {
+		++windows;
+		const uint64_t h = murmur_hash()(key);
+		if (h & (SAMPLING - 1))
+			return;
+		const unsigned c = count(h);
+		freq += std::max(c > noise ? c - noise : 0u, 1u);
+		++sampled;
+	});
+	const double w = 1.0 + (sampled > 0 ? (double)windows * freq / sampled : (double)windows);
+	return (uint32_t)std::min(w, (double)UINT32_MAX);
+}
+
+static void add_seqs(size_t chunk, size_t thread_id, WorkSketch *sketch, const Sequence_set *seqs)
+{
+	const size_t end = std::min((chunk + 1) * CHUNK_SIZE, seqs->get_length());
+	for (size_t i = chunk * CHUNK_SIZE; i < end; ++i)
+		sketch->add(seqs->ptr(i), seqs->length(i));
+}
+
+static void estimate_seqs(size_t chunk, size_t thread_id, const WorkSketch *sketch, const Sequence_set *seqs, vector<uint32_t> *work)
+{
+	const size_t end = std::min((chunk + 1) * CHUNK_SIZE, seqs->get_length());
+	for (size_t i = chunk * CHUNK_SIZE; i < end; ++i)
+		(*work)[i] = sketch->work(seqs->ptr(i), seqs->length(i));
+}
+
+void WorkSketch::add(const Sequence_set &seqs)
+{
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, (seqs.get_length() + CHUNK_SIZE - 1) / CHUNK_SIZE, add_seqs, this, &seqs);
+}
+
+void WorkSketch::estimate(const Sequence_set &seqs, vector<uint32_t> &work) const
+{
+	work.resize(seqs.get_length());
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, (seqs.get_length() + CHUNK_SIZE - 1) / CHUNK_SIZE, estimate_seqs, this, &seqs, &work);
+}
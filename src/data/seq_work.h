@@ -0,0 +1,53 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include "sequence_set.h"
+
+// Estimates the search work of database sequences at makedb time. The work of a sequence is the number of its
+// unmasked k-mer windows times the mean database frequency of its k-mers, which approximates the seed hits it draws
+// from queries of a composition similar to the database. Frequencies are taken from a count-min sketch of a sample
+// of the k-mers of all batches added so far, so estimates are computed after the complete database has been added.
+struct WorkSketch
+{
+	WorkSketch();
+	void add(const Letter *seq, size_t len);
+	uint32_t work(const Letter *seq, size_t len) const;
+	void add(const Sequence_set &seqs);
+	void estimate(const Sequence_set &seqs, std::vector<uint32_t> &work) const;
+
+	enum { K = 7, SAMPLING = 8, DEPTH = 2, WIDTH_BITS = 24 };
+
+private:
+	unsigned count(uint64_t h) const;
+	static size_t index(uint64_t h, unsigned row)
+	{
+		return (h >> (8 + row * WIDTH_BITS)) & ((1llu << WIDTH_BITS) - 1);
+	}
+
+	std::unique_ptr<std::atomic<uint16_t>[]> data_;
+	std::atomic<uint64_t> total_;
+};
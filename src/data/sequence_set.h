@@ -33,6 +33,10 @@ struct Sequence_set : public String_set<Letter, sequence::DELIMITER, 1>
 
 	Sequence_set()
 	{ }
+
+	Sequence_set(Letter* view, std::vector<size_t>&& limits, char* map = nullptr, size_t map_size = 0):
+		String_set(view, std::move(limits), map, map_size)
+	{ }
 	
 	void print_stats() const
 	{
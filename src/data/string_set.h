@@ -23,8 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 #include <assert.h>
 #include <vector>
+#include <memory>
 #include <stddef.h>
 #include "../basic/sequence.h"
+#include "../util/system/system.h"
 
 template<typename _t, char _pchar = '\xff', size_t _padding = 1lu>
 struct String_set
@@ -34,9 +36,28 @@ struct String_set
 	static const char DELIMITER = _pchar;
 
 	String_set():
-		data_ (PERIMETER_PADDING)
+		data_ (PERIMETER_PADDING),
+		view_ (nullptr)
 	{ limits_.push_back(PERIMETER_PADDING); }
 
+	// Creates a set that refers to externally stored strings laid out like the
+	// internal buffer (perimeter padding, strings separated by the padding char).
+	// If map is not null, the memory is unmapped on destruction.
+	String_set(_t* view, std::vector<size_t>&& limits, char* map = nullptr, size_t map_size = 0):
+		view_ (view),
+		limits_ (std::move(limits)),
+		map_ (map, Unmap(map_size))
+	{ }
+
+	String_set(const String_set& s):
+		data_ (s.view_ ? std::vector<_t>(s.view_, s.view_ + s.raw_len() + PERIMETER_PADDING) : s.data_),
+		view_ (nullptr),
+		limits_ (s.limits_)
+	{ }
+
+	String_set(String_set&& s) = default;
+	String_set& operator=(String_set&& s) = default;
+
 	void finish_reserve()
 	{
 		data_.resize(raw_len() + PERIMETER_PADDING);
@@ -68,10 +89,10 @@ struct String_set
 	}
 
 	_t* ptr(size_t i)
-	{ return &data_[limits_[i]]; }
+	{ return data(limits_[i]); }
 
 	const _t* ptr(size_t i) const
-	{ return &data_[limits_[i]]; }
+	{ return data(limits_[i]); }
 
 	size_t check_idx(size_t i) const
 	{
@@ -93,10 +114,13 @@ struct String_set
 	{ return raw_len() - get_length() - PERIMETER_PADDING; }
 
 	_t* data(uint64_t p = 0)
-	{ return &data_[p]; }
+	{ return view_ ? view_ + p : &data_[p]; }
 
 	const _t* data(uint64_t p = 0) const
-	{ return &data_[p]; }
+	{ return view_ ? view_ + p : &data_[p]; }
+
+	bool is_view() const
+	{ return view_ != nullptr; }
 
 	size_t position(const _t* p) const
 	{ return p - data(); }
@@ -125,7 +149,18 @@ struct String_set
 
 private:
 
+	struct Unmap {
+		Unmap(size_t size = 0):
+			size(size)
+		{ }
+		void operator()(char* p) const
+		{ unmap_file_range(p, size); }
+		size_t size;
+	};
+
 	std::vector<_t> data_;
+	_t* view_;
 	std::vector<size_t> limits_;
+	std::unique_ptr<char, Unmap> map_;
 
 };
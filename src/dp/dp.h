@@ -233,22 +233,28 @@ struct StatTraceback {};
 struct VectorTraceback {};
 struct ScoreOnly {};
 struct ScoreWithCoords {};
+struct CheckpointTraceback {};
 
 enum { TRACEBACK = 1, PARALLEL = 2, FULL_MATRIX = 4, WITH_COORDINATES = 8 };
 
 struct NoCBS {
 	constexpr void* operator[](int i) const { return nullptr; }
 };
+
+// Computes the traceback of the local alignment ending at (i_end, j_end) with the given score in memory linear in the
+// number of columns, restricted to the diagonals [d_begin, d_end). matrix is indexed as matrix[target_letter * 32 +
+// query_letter], query_bias may be nullptr.
+void checkpoint_traceback(Hsp& out, const sequence& query, const sequence& target, const int* matrix, const int8_t* query_bias, int gap_open, int gap_extend, int d_begin, int d_end, int i_end, int j_end, int score);
 	
 namespace Swipe {
 
-//DECL_DISPATCH(std::list<Hsp>, swipe, (const sequence &query, const sequence *subject_begin, const sequence *subject_end, int score_cutoff))
+//DECL_DISPATCH(HspList, swipe, (const sequence &query, const sequence *subject_begin, const sequence *subject_end, int score_cutoff))
 
 }
 
 namespace BandedSwipe {
 
-DECL_DISPATCH(std::list<Hsp>, swipe, (const sequence &query, std::vector<DpTarget> &targets8, std::vector<DpTarget> &targets16, DynamicIterator<DpTarget>* targets, Frame frame, const Bias_correction *composition_bias, int flags, Statistics &stat))
+DECL_DISPATCH(HspList, swipe, (const sequence &query, std::vector<DpTarget> &targets8, std::vector<DpTarget> &targets16, DynamicIterator<DpTarget>* targets, Frame frame, const Bias_correction *composition_bias, int flags, Statistics &stat))
 
 }
 
@@ -259,4 +265,4 @@ void banded_sw(const sequence &query, const sequence &subject, int d_begin, int
 void anchored_3frame_dp(const TranslatedSequence &query, sequence &subject, const DiagonalSegment &anchor, Hsp &out, int gap_open, int gap_extend, int frame_shift);
 int sw_3frame(const TranslatedSequence &query, Strand strand, const sequence &subject, int gap_open, int gap_extend, int frame_shift, Hsp &out);
 
-DECL_DISPATCH(std::list<Hsp>, banded_3frame_swipe, (const TranslatedSequence &query, Strand strand, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, DpStat &stat, bool score_only, bool parallel))
+DECL_DISPATCH(HspList, banded_3frame_swipe, (const TranslatedSequence &query, Strand strand, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, DpStat &stat, bool score_only, bool parallel))
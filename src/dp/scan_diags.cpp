@@ -30,7 +30,26 @@ namespace DP { namespace DISPATCH_ARCH {
 
 void scan_diags128(const LongScoreProfile& qp, sequence s, int d_begin, int j_begin, int j_end, int *out)
 {
-#ifdef __AVX2__
+#ifdef __AVX512BW__
+	const int qlen = (int)qp.length();
+
+	const int j0 = std::max(j_begin, -(d_begin + 128 - 1)),
+		i0 = d_begin + j0,
+		j1 = std::min(qlen - d_begin, j_end);
+	__m512i v1 = _mm512_set1_epi8(SCHAR_MIN), max1 = v1, v2 = _mm512_set1_epi8(SCHAR_MIN), max2 = v2;
+	for (int i = i0, j = j0; j < j1; ++j, ++i) {
+		const int8_t* q = qp.get(s[j], i);
+		v1 = _mm512_adds_epi8(v1, _mm512_loadu_si512(q));
+		max1 = _mm512_max_epi8(max1, v1);
+		v2 = _mm512_adds_epi8(v2, _mm512_loadu_si512(q + 64));
+		max2 = _mm512_max_epi8(max2, v2);
+	}
+	alignas(64) int8_t scores[128];
+	_mm512_store_si512(scores, max1);
+	_mm512_store_si512(scores + 64, max2);
+	for (int i = 0; i < 128; ++i)
+		out[i] = (int)scores[i] - SCHAR_MIN;
+#elif defined(__AVX2__)
 	typedef score_vector<int8_t> Sv;
 	const int qlen = (int)qp.length();
 
@@ -128,7 +147,23 @@ void scan_diags128(const LongScoreProfile& qp, sequence s, int d_begin, int j_be
 
 void scan_diags64(const LongScoreProfile& qp, sequence s, int d_begin, int j_begin, int j_end, int* out)
 {
-#ifdef __AVX2__
+#ifdef __AVX512BW__
+	const int qlen = (int)qp.length();
+
+	const int j0 = std::max(j_begin, -(d_begin + 64 - 1)),
+		i0 = d_begin + j0,
+		j1 = std::min(qlen - d_begin, j_end);
+	__m512i v1 = _mm512_set1_epi8(SCHAR_MIN), max1 = v1;
+	for (int i = i0, j = j0; j < j1; ++j, ++i) {
+		const int8_t* q = qp.get(s[j], i);
+		v1 = _mm512_adds_epi8(v1, _mm512_loadu_si512(q));
+		max1 = _mm512_max_epi8(max1, v1);
+	}
+	alignas(64) int8_t scores[64];
+	_mm512_store_si512(scores, max1);
+	for (int i = 0; i < 64; ++i)
+		out[i] = (int)scores[i] - SCHAR_MIN;
+#elif defined(__AVX2__)
 	typedef score_vector<int8_t> Sv;
 	const int qlen = (int)qp.length();
 
@@ -202,7 +237,23 @@ void scan_diags64(const LongScoreProfile& qp, sequence s, int d_begin, int j_beg
 
 void scan_diags(const LongScoreProfile& qp, sequence s, int d_begin, int d_end, int j_begin, int j_end, int* out)
 {
-#ifdef __AVX2__
+#ifdef __AVX512BW__
+	const int qlen = (int)qp.length();
+
+	const int j0 = std::max(j_begin, -(d_end - 1)),
+		i0 = d_begin + j0,
+		j1 = std::min(qlen - d_begin, j_end);
+	__m512i v1 = _mm512_set1_epi8(SCHAR_MIN), max1 = v1;
+	for (int i = i0, j = j0; j < j1; ++j, ++i) {
+		const int8_t* q = qp.get(s[j], i);
+		v1 = _mm512_adds_epi8(v1, _mm512_loadu_si512(q));
+		max1 = _mm512_max_epi8(max1, v1);
+	}
+	alignas(64) int8_t scores[64];
+	_mm512_store_si512(scores, max1);
+	for (int i = 0; i < 64; ++i)
+		out[i] = (int)scores[i] - SCHAR_MIN;
+#elif defined(__AVX2__)
 	typedef score_vector<int8_t> Sv;
 	const int qlen = (int)qp.length(), band = d_end - d_begin;
 	assert(band % 32 == 0);
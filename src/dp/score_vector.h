@@ -53,6 +53,8 @@ struct ScoreTraits
 };
 
 
+// Score vectors of the SWIPE kernels. The AVX-512 build (ARCH_ID 3) uses 512 bit registers with 64 channels for
+// 8 bit and 32 channels for 16 bit scores.
 template<typename _score>
 struct score_vector
 { };
@@ -315,7 +317,7 @@ static inline int32_t load_sv(const int32_t *x) {
 	return *x;
 }
 
-static inline int32_t load_sv(int32_t a, int32_t b, uint32_t mask) {
+static inline int32_t load_sv(int32_t a, int32_t b, uint64_t mask) {
 	return mask ? b : a;
 }
 
@@ -324,7 +326,9 @@ static inline int32_t load_sv(int32_t a, int32_t b, uint32_t mask) {
 template<typename _t, typename _p>
 static inline void store_sv(const DISPATCH_ARCH::score_vector<_t> &sv, _p *dst)
 {
-#if ARCH_ID == 2
+#if ARCH_ID == 3
+	_mm512_storeu_si512((__m512i*)dst, sv.data_);
+#elif ARCH_ID >= 2
 	_mm256_storeu_si256((__m256i*)dst, sv.data_);
 #else
 	_mm_storeu_si128((__m128i*)dst, sv.data_);
@@ -25,7 +25,148 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace DISPATCH_ARCH {
 
-#if ARCH_ID == 2
+#if ARCH_ID == 3
+
+template<>
+struct score_vector<int16_t>
+{
+
+	typedef __m512i Register;
+
+	score_vector() :
+		data_(_mm512_set1_epi16(SHRT_MIN))
+	{}
+
+	explicit score_vector(int x) :
+		data_(_mm512_set1_epi16(x))
+	{}
+
+	explicit score_vector(int16_t x) :
+		data_(_mm512_set1_epi16(x))
+	{}
+
+	explicit score_vector(__m512i data) :
+		data_(data)
+	{ }
+
+	explicit score_vector(const int16_t* x) :
+		data_(_mm512_loadu_si512((const __m512i*)x))
+	{}
+
+	explicit score_vector(const uint16_t* x) :
+		data_(_mm512_loadu_si512((const __m512i*)x))
+	{}
+
+	score_vector(int16_t a, int16_t b, uint64_t mask) :
+		data_(_mm512_mask_blend_epi16((__mmask32)mask, _mm512_set1_epi16(a), _mm512_set1_epi16(b)))
+	{}
+
+	score_vector(unsigned a, Register seq)
+	{
+		const __m512i row_lo = _mm512_broadcast_i64x4(_mm256_load_si256(reinterpret_cast<const __m256i*>(&score_matrix.matrix8u_low()[a << 5])));
+		const __m512i row_hi = _mm512_broadcast_i64x4(_mm256_load_si256(reinterpret_cast<const __m256i*>(&score_matrix.matrix8u_high()[a << 5])));
+
+		const __m512i high_mask = _mm512_slli_epi16(_mm512_and_si512(seq, _mm512_set1_epi8('\x10')), 3);
+		const __m512i seq_low = _mm512_or_si512(seq, high_mask);
+		const __m512i seq_high = _mm512_or_si512(seq, _mm512_xor_si512(high_mask, _mm512_set1_epi8('\x80')));
+
+		const __m512i s1 = _mm512_shuffle_epi8(row_lo, seq_low);
+		const __m512i s2 = _mm512_shuffle_epi8(row_hi, seq_high);
+		data_ = _mm512_and_si512(_mm512_or_si512(s1, s2), _mm512_set1_epi16(255));
+		data_ = _mm512_subs_epi16(data_, _mm512_set1_epi16(score_matrix.bias()));
+	}
+
+	score_vector operator+(const score_vector& rhs) const
+	{
+		return score_vector(_mm512_adds_epi16(data_, rhs.data_));
+	}
+
+	score_vector operator-(const score_vector& rhs) const
+	{
+		return score_vector(_mm512_subs_epi16(data_, rhs.data_));
+	}
+
+	score_vector& operator+=(const score_vector& rhs) {
+		data_ = _mm512_adds_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& operator-=(const score_vector& rhs)
+	{
+		data_ = _mm512_subs_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& operator &=(const score_vector& rhs) {
+		data_ = _mm512_and_si512(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& operator++() {
+		data_ = _mm512_adds_epi16(data_, _mm512_set1_epi16(1));
+		return *this;
+	}
+
+	score_vector& max(const score_vector& rhs)
+	{
+		data_ = _mm512_max_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	friend score_vector blend(const score_vector &v, const score_vector &w, const score_vector &mask) {
+		return score_vector(_mm512_mask_blend_epi16(_mm512_movepi16_mask(mask.data_), v.data_, w.data_));
+	}
+
+	score_vector operator==(const score_vector &v) const {
+		return score_vector(_mm512_movm_epi16(_mm512_cmpeq_epi16_mask(data_, v.data_)));
+	}
+
+	friend FORCE_INLINE uint32_t cmp_mask(const score_vector &v, const score_vector &w) {
+		return (uint32_t)_mm512_cmpeq_epi16_mask(v.data_, w.data_);
+	}
+
+	friend score_vector max(const score_vector& lhs, const score_vector& rhs)
+	{
+		return score_vector(_mm512_max_epi16(lhs.data_, rhs.data_));
+	}
+
+	void store(int16_t* ptr) const
+	{
+		_mm512_storeu_si512((__m512i*)ptr, data_);
+	}
+
+	int16_t operator[](int i) const {
+		int16_t d[32];
+		store(d);
+		return d[i];
+	}
+
+	void set(int i, int16_t x) {
+		alignas(64) int16_t d[32];
+		store(d);
+		d[i] = x;
+		data_ = _mm512_load_si512((__m512i*)d);
+	}
+
+	// Sign extends the 32 scores in the lower half of the register.
+	void expand_from_8bit() {
+		data_ = _mm512_cvtepi8_epi16(_mm512_castsi512_si256(data_));
+	}
+
+	friend std::ostream& operator<<(std::ostream& s, score_vector v)
+	{
+		int16_t x[32];
+		v.store(x);
+		for (unsigned i = 0; i < 32; ++i)
+			printf("%3i ", (int)x[i]);
+		return s;
+	}
+
+	__m512i data_;
+
+};
+
+#elif ARCH_ID >= 2
 
 template<>
 struct score_vector<int16_t>
@@ -59,10 +200,10 @@ struct score_vector<int16_t>
 		data_(_mm256_loadu_si256((const __m256i*)x))
 	{}
 
-	score_vector(int16_t a, int16_t b, uint32_t mask) {
+	score_vector(int16_t a, int16_t b, uint64_t mask) {
 		alignas(32) int16_t s[16];
 		for (uint32_t i = 0; i < 16; ++i)
-			if (mask & (1 << i))
+			if (mask & ((uint64_t)1 << i))
 				s[i] = b;
 			else
 				s[i] = a;
@@ -215,10 +356,10 @@ struct score_vector<int16_t>
 		data_(_mm_loadu_si128((const __m128i*)x))
 	{}
 
-	score_vector(int16_t a, int16_t b, uint32_t mask) {
+	score_vector(int16_t a, int16_t b, uint64_t mask) {
 		alignas(32) int16_t s[8];
 		for (uint32_t i = 0; i < 8; ++i)
-			if (mask & (1 << i))
+			if (mask & ((uint64_t)1 << i))
 				s[i] = b;
 			else
 				s[i] = a;
@@ -369,7 +510,23 @@ template<>
 struct ScoreTraits<score_vector<int16_t>>
 {
 	typedef ::DISPATCH_ARCH::SIMD::Vector<int16_t> Vector;
-#if ARCH_ID == 2
+#if ARCH_ID == 3
+	enum { CHANNELS = 32 };
+	typedef uint32_t Mask;
+	struct TraceMask {
+		uint64_t gap;
+		uint64_t open;
+		static FORCE_INLINE uint64_t make(uint32_t vmask, uint32_t hmask) {
+			return (uint64_t)vmask << 32 | (uint64_t)hmask;
+		}
+		static uint64_t vmask(int channel) {
+			return (uint64_t)1 << (channel + 32);
+		}
+		static uint64_t hmask(int channel) {
+			return (uint64_t)1 << channel;
+		}
+	};
+#elif ARCH_ID >= 2
 	enum { CHANNELS = 16 };
 	typedef uint16_t Mask;
 	struct TraceMask {
@@ -444,7 +601,7 @@ static inline DISPATCH_ARCH::score_vector<int16_t> load_sv(const uint16_t *x) {
 	return DISPATCH_ARCH::score_vector<int16_t>(x);
 }
 
-static inline DISPATCH_ARCH::score_vector<int16_t> load_sv(int16_t a, int16_t b, uint32_t mask) {
+static inline DISPATCH_ARCH::score_vector<int16_t> load_sv(int16_t a, int16_t b, uint64_t mask) {
 	return DISPATCH_ARCH::score_vector<int16_t>(a, b, mask);
 }
 
@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "swipe.h"
 #include "target_iterator.h"
 #include "../../util/data_structures/mem_buffer.h"
+#include "../../util/parallel/thread_pool.h"
 #include "../score_vector_int16.h"
 
 using std::list;
@@ -386,7 +387,7 @@ Hsp traceback(sequence *query, Strand strand, int dna_len, const Banded3FrameSwi
 }
 
 template<typename _sv, typename _traceback>
-list<Hsp> banded_3frame_swipe(
+HspList banded_3frame_swipe(
 	const TranslatedSequence &query,
 	Strand strand, vector<DpTarget>::const_iterator subject_begin,
 	vector<DpTarget>::const_iterator subject_end,
@@ -488,7 +489,7 @@ list<Hsp> banded_3frame_swipe(
 		++j;
 	}
 	
-	list<Hsp> out;
+	HspList out;
 	for (int i = 0; i < targets.n_targets; ++i) {
 		if (best[i] < ScoreTraits<_sv>::max_score()) {
 			const int score = ScoreTraits<_sv>::int_score(best[i]) * config.cbs_matrix_scale;
@@ -503,7 +504,7 @@ list<Hsp> banded_3frame_swipe(
 }
 
 template<typename _sv>
-list<Hsp> banded_3frame_swipe_targets(vector<DpTarget>::const_iterator begin,
+HspList banded_3frame_swipe_targets(vector<DpTarget>::const_iterator begin,
 	vector<DpTarget>::const_iterator end,
 	bool score_only,
 	const TranslatedSequence &query,
@@ -512,7 +513,7 @@ list<Hsp> banded_3frame_swipe_targets(vector<DpTarget>::const_iterator begin,
 	bool parallel,
 	vector<DpTarget> &overflow)
 {
-	list<Hsp> out;
+	HspList out;
 	for (vector<DpTarget>::const_iterator i = begin; i < end; i += ScoreTraits<_sv>::CHANNELS) {
 		if (score_only || config.traceback_mode == TracebackMode::SCORE_ONLY)
 			out.splice(out.end(), banded_3frame_swipe<_sv, DP::ScoreOnly>(query, strand, i, i + std::min(vector<DpTarget>::const_iterator::difference_type(ScoreTraits<_sv>::CHANNELS), end - i), stat, parallel, overflow));
@@ -528,7 +529,7 @@ void banded_3frame_swipe_worker(vector<DpTarget>::const_iterator begin,
 	bool score_only,
 	const TranslatedSequence *query,
 	Strand strand,
-	list<Hsp> *out,
+	HspList *out,
 	vector<DpTarget> *overflow)
 {
 	DpStat stat;
@@ -546,38 +547,24 @@ void banded_3frame_swipe_worker(vector<DpTarget>::const_iterator begin,
 	*overflow = std::move(of);
 }
 
-list<Hsp> banded_3frame_swipe(const TranslatedSequence &query, Strand strand, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, DpStat &stat, bool score_only, bool parallel)
+HspList banded_3frame_swipe(const TranslatedSequence &query, Strand strand, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, DpStat &stat, bool score_only, bool parallel)
 {
 	vector<DpTarget> overflow16, overflow32;
 #ifdef __SSE2__
 	task_timer timer("Banded 3frame swipe (sort)", parallel ? 3 : UINT_MAX);
 	std::stable_sort(target_begin, target_end);
-	list<Hsp> out;
+	HspList out;
 	if (parallel) {
 		timer.go("Banded 3frame swipe (run)");
-		vector<thread> threads;
-		vector<list<Hsp>*> thread_out;
+		vector<HspList> thread_out(config.threads_);
 		vector<vector<DpTarget>> thread_overflow(config.threads_);
 		atomic<size_t> next(0);
-		for (size_t i = 0; i < config.threads_; ++i) {
-			thread_out.push_back(new list<Hsp>);
-			threads.emplace_back(banded_3frame_swipe_worker,
-				target_begin,
-				target_end,
-				&next,
-				score_only,
-				&query,
-				strand,
-				thread_out.back(),
-				&thread_overflow[i]);
-		}
-		for (auto &t : threads)
-			t.join();
+		Util::Parallel::run_tasks(config.threads_, [&](size_t i) {
+			banded_3frame_swipe_worker(target_begin, target_end, &next, score_only, &query, strand, &thread_out[i], &thread_overflow[i]);
+		});
 		timer.go("Banded 3frame swipe (merge)");
-		for (list<Hsp>* l : thread_out) {
-			out.splice(out.end(), *l);
-			delete l;
-		}
+		for (HspList& l : thread_out)
+			out.splice(out.end(), l);
 		overflow16.reserve(std::accumulate(thread_overflow.begin(), thread_overflow.end(), (size_t)0, [](size_t n, const vector<DpTarget> &v) { return n + v.size(); }));
 		for (const vector<DpTarget> &v : thread_overflow)
 			overflow16.insert(overflow16.end(), v.begin(), v.end());
@@ -0,0 +1,206 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "../dp.h"
+
+using std::vector;
+using std::max;
+using std::min;
+
+namespace DP {
+
+// Local alignment matrix restricted to the rectangle up to the alignment end and to the diagonals [d_begin, d_end).
+// Only every k-th column is kept during the forward pass. The traceback recomputes one segment of k columns at a
+// time from the checkpoint preceding it, so that memory is O(width * (cols / k + k)) instead of O(width * cols).
+struct CheckpointMatrix {
+
+	CheckpointMatrix(const sequence& query, const sequence& target, const int* matrix, const int8_t* query_bias, int gap_open, int gap_extend, int d_begin, int d_end, int i_end, int j_end) :
+		query_(query),
+		target_(target),
+		matrix_(matrix),
+		query_bias_(query_bias),
+		go_(gap_open + gap_extend),
+		ge_(gap_extend),
+		d_begin_(d_begin),
+		d_end_(d_end),
+		i_end_(i_end),
+		j_first_(max(0, 1 - d_end)),
+		j_end_(j_end),
+		width_(min(d_end - d_begin, i_end + 1)),
+		k_(max((int)sqrt((double)(j_end - j_first_ + 1)), 1)),
+		segment_(-1)
+	{
+		const size_t segments = (j_end - j_first_) / k_ + 1;
+		checkpoint_h_.resize(segments * width_);
+		checkpoint_e_.resize(segments * width_);
+		h_.resize((size_t)k_ * width_);
+		e_.resize((size_t)k_ * width_);
+		f_.resize((size_t)k_ * width_);
+		vector<int> h(width_, 0), e(width_, 0), h2(width_), e2(width_), e_in(width_), f_in(width_);
+		for (int j = j_first_; j <= j_end; ++j) {
+			if ((j - j_first_) % k_ == 0) {
+				const size_t s = (size_t)((j - j_first_) / k_) * width_;
+				std::copy(h.begin(), h.end(), checkpoint_h_.begin() + s);
+				std::copy(e.begin(), e.end(), checkpoint_e_.begin() + s);
+			}
+			column(j, h.data(), e.data(), h2.data(), e_in.data(), f_in.data(), e2.data());
+			h.swap(h2);
+			e.swap(e2);
+		}
+		end_score = h[i_end - lo(j_end)];
+	}
+
+	int lo(int j) const {
+		return max(0, j + d_begin_);
+	}
+
+	int hi(int j) const {
+		return min(i_end_, j + d_end_ - 1);
+	}
+
+	int score(int i, int j) const {
+		const int m = match_score(i, j);
+		return query_bias_ ? m + query_bias_[i] : m;
+	}
+
+	int match_score(int i, int j) const {
+		return matrix_[int(target_[j]) * 32 + int(query_[i])];
+	}
+
+	// Computes column j from the scores and outgoing horizontal gaps of column j - 1 as in the SWIPE kernels. Cells
+	// outside of the matrix have zero scores. Also returns the gap scores entering the cells of column j.
+	void column(int j, const int* h_prev, const int* e_prev, int* h, int* e_in, int* f_in, int* e_out) const {
+		const int l = lo(j), l_prev = lo(j - 1), hi_prev = j > j_first_ ? hi(j - 1) : -1;
+		int vgap = 0;
+		for (int i = l; i <= hi(j); ++i) {
+			const int diag = i - 1 >= l_prev && i - 1 <= hi_prev ? h_prev[i - 1 - l_prev] : 0;
+			const int hgap = i >= l_prev && i <= hi_prev ? e_prev[i - l_prev] : 0;
+			const int current = max(max(max(diag + score(i, j), vgap), hgap), 0);
+			const int r = i - l;
+			h[r] = current;
+			e_in[r] = hgap;
+			f_in[r] = vgap;
+			e_out[r] = max(hgap - ge_, current - go_);
+			vgap = max(vgap - ge_, current - go_);
+		}
+	}
+
+	// Recomputes the segment containing column j, storing the scores of all its cells.
+	void load(int j) {
+		const int s = (j - j_first_) / k_;
+		if (s == segment_)
+			return;
+		segment_ = s;
+		vector<int> h(checkpoint_h_.begin() + (size_t)s * width_, checkpoint_h_.begin() + (size_t)(s + 1) * width_),
+			e(checkpoint_e_.begin() + (size_t)s * width_, checkpoint_e_.begin() + (size_t)(s + 1) * width_),
+			e_out(width_);
+		const int j0 = j_first_ + s * k_, j1 = min(j0 + k_, j_end_ + 1);
+		for (int c = j0; c < j1; ++c) {
+			const size_t offset = (size_t)(c - j0) * width_;
+			column(c, h.data(), e.data(), &h_[offset], &e_[offset], &f_[offset], e_out.data());
+			std::copy(h_.begin() + offset, h_.begin() + offset + width_, h.begin());
+			e.swap(e_out);
+		}
+	}
+
+	size_t idx(int i, int j) const {
+		return (size_t)(j - j_first_ - segment_ * k_) * width_ + (i - lo(j));
+	}
+
+	int h(int i, int j) const {
+		return h_[idx(i, j)];
+	}
+
+	int e(int i, int j) const {
+		return e_[idx(i, j)];
+	}
+
+	int f(int i, int j) const {
+		return f_[idx(i, j)];
+	}
+
+	const sequence query_, target_;
+	const int* matrix_;
+	const int8_t* query_bias_;
+	const int go_, ge_, d_begin_, d_end_, i_end_, j_first_, j_end_, width_, k_;
+	int segment_, end_score;
+	vector<int> checkpoint_h_, checkpoint_e_, h_, e_, f_;
+
+};
+
+void checkpoint_traceback(Hsp& out, const sequence& query, const sequence& target, const int* matrix, const int8_t* query_bias, int gap_open, int gap_extend, int d_begin, int d_end, int i_end, int j_end, int score)
+{
+	CheckpointMatrix dp(query, target, matrix, query_bias, gap_open, gap_extend, d_begin, d_end, i_end, j_end);
+	if (dp.end_score != score)
+		throw std::runtime_error("Traceback error.");
+
+	const int go = gap_open + gap_extend;
+	out.transcript.reserve(size_t(score * config.transcript_len_estimate));
+	out.query_range.end_ = i_end + 1;
+	out.subject_range.end_ = j_end + 1;
+	int i = i_end, j = j_end, s = 0;
+
+	// Follows the same preference as the vector traceback: gaps before matches, vertical before horizontal gaps,
+	// gap openings before extensions.
+	while (i >= 0 && j >= 0 && s < score) {
+		dp.load(j);
+		const int h = dp.h(i, j);
+		if (h == dp.f(i, j)) {
+			int l = 0;
+			do {
+				++l;
+				--i;
+			} while (dp.f(i + 1, j) != dp.h(i, j) - go && i > 0);
+			out.push_gap(op_insertion, l, target.data() + j + l);
+			s -= gap_open + l * gap_extend;
+		}
+		else if (h == dp.e(i, j)) {
+			int l = 0, e;
+			do {
+				++l;
+				e = dp.e(i, j);
+				--j;
+				dp.load(j);
+			} while (e != dp.h(i, j) - go && j > 0);
+			out.push_gap(op_deletion, l, target.data() + j + l);
+			s -= gap_open + l * gap_extend;
+		}
+		else {
+			const Letter q = query[i], t = target[j];
+			s += dp.score(i, j);
+			out.push_match(q, t, dp.match_score(i, j) > 0);
+			--i;
+			--j;
+		}
+	}
+
+	if (s != score)
+		throw std::runtime_error("Traceback error.");
+
+	out.query_range.begin_ = i + 1;
+	out.subject_range.begin_ = j + 1;
+	out.transcript.reverse();
+	out.transcript.push_terminator();
+}
+
+}
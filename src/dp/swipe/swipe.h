@@ -99,6 +99,18 @@ _score add_cbs_scalar(_score x, void *b) {
 	return x;
 }
 
+namespace DP {
+	struct NoCBS;
+}
+
+static inline const int8_t* cbs_ptr(const int8_t* b) {
+	return b;
+}
+
+static inline const int8_t* cbs_ptr(const DP::NoCBS&) {
+	return nullptr;
+}
+
 template<typename _sv>
 MSC_INLINE void make_gap_mask(typename ::DISPATCH_ARCH::ScoreTraits<_sv>::TraceMask *trace_mask, const _sv& current_cell, const _sv& vertical_gap, const _sv& horizontal_gap) {
 	trace_mask->gap = ::DISPATCH_ARCH::ScoreTraits<_sv>::TraceMask::make(cmp_mask(current_cell, vertical_gap), cmp_mask(current_cell, horizontal_gap));
@@ -117,13 +129,9 @@ template<typename _sv>
 MSC_INLINE void make_open_mask(std::nullptr_t, const _sv&, const _sv&, const _sv&) {
 }
 
-namespace DP {
-	struct NoCBS;
-}
-
 template<typename _sv, typename _cbs>
 struct CBSBuffer {
-	CBSBuffer(const DP::NoCBS&, int, uint32_t) {}
+	CBSBuffer(const DP::NoCBS&, int, uint64_t) {}
 	void* operator()(int i) const {
 		return nullptr;
 	}
@@ -131,7 +139,7 @@ struct CBSBuffer {
 
 template<typename _sv>
 struct CBSBuffer<_sv, const int8_t*> {
-	CBSBuffer(const int8_t* v, int l, uint32_t channel_mask) {
+	CBSBuffer(const int8_t* v, int l, uint64_t channel_mask) {
 		typedef typename ::DISPATCH_ARCH::ScoreTraits<_sv>::Score Score;
 		data.reserve(l);
 		for (int i = 0; i < l; ++i)
@@ -140,7 +148,7 @@ struct CBSBuffer<_sv, const int8_t*> {
 	_sv operator()(int i) const {
 		return data[i];
 	}
-	std::vector<_sv, Util::Memory::AlignmentAllocator<_sv, 32>> data;
+	std::vector<_sv, Util::Memory::AlignmentAllocator<_sv, 64>> data;
 };
 
 
@@ -279,7 +287,19 @@ struct SwipeProfile
 	}
 
 	void set(const int8_t** target_scores) {
-#if ARCH_ID == 2
+#if ARCH_ID == 3
+		// The scores of 32 targets are transposed at a time, the 8 bit kernel has 64 channels.
+		alignas(32) int8_t lo[32 * 32], hi[32 * 32];
+		transpose(target_scores, 32, lo, __m256i());
+		if (ScoreTraits<_sv>::CHANNELS > 32)
+			transpose(target_scores + 32, 32, hi, __m256i());
+		for (size_t i = 0; i < AMINO_ACID_COUNT; ++i) {
+			const __m256i l = _mm256_load_si256((const __m256i*)&lo[i * 32]);
+			const __m256i h = ScoreTraits<_sv>::CHANNELS > 32 ? _mm256_load_si256((const __m256i*)&hi[i * 32]) : _mm256_setzero_si256();
+			data_[i] = _sv(_mm512_inserti64x4(_mm512_castsi256_si512(l), h, 1));
+			data_[i].expand_from_8bit();
+		}
+#elif ARCH_ID >= 2
 		transpose(target_scores, 32, (int8_t*)data_, __m256i());
 		for (size_t i = 0; i < AMINO_ACID_COUNT; ++i)
 			data_[i].expand_from_8bit();
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../score_vector_int8.h"
 #include "../../util/log_stream.h"
 #include "../../util/dynamic_iterator.h"
+#include "../../util/parallel/thread_pool.h"
 
 using std::list;
 using std::atomic;
@@ -37,14 +38,14 @@ using std::thread;
 namespace DP { namespace Swipe { namespace DISPATCH_ARCH {
 
 template<typename _sv, typename _traceback, typename _cbs>
-list<Hsp> swipe(const sequence& query, Frame frame, DynamicIterator<DpTarget>& targets, _cbs composition_bias, vector<DpTarget>& overflow, Statistics& stats);
+HspList swipe(const sequence& query, Frame frame, DynamicIterator<DpTarget>& targets, _cbs composition_bias, vector<DpTarget>& overflow, Statistics& stats);
 
 }}}
 
 namespace DP { namespace BandedSwipe { namespace DISPATCH_ARCH {
 
 template<typename _sv, typename _traceback, typename _cbs>
-list<Hsp> swipe(
+HspList swipe(
 	const sequence &query,
 	Frame frame,
 	vector<DpTarget>::const_iterator subject_begin,
@@ -54,7 +55,7 @@ list<Hsp> swipe(
 	Statistics &stat);
 
 template<typename _sv, typename _traceback>
-list<Hsp> swipe_dispatch_cbs(
+HspList swipe_dispatch_cbs(
 	const sequence &query,
 	Frame frame,
 	vector<DpTarget>::const_iterator subject_begin,
@@ -70,7 +71,7 @@ list<Hsp> swipe_dispatch_cbs(
 }
 
 template<typename _sv, typename _traceback>
-list<Hsp> full_swipe_dispatch_cbs(
+HspList full_swipe_dispatch_cbs(
 	const sequence &query,
 	Frame frame,
 	DynamicIterator<DpTarget>& targets,
@@ -84,8 +85,32 @@ list<Hsp> full_swipe_dispatch_cbs(
 		return DP::Swipe::DISPATCH_ARCH::swipe<_sv, _traceback>(query, frame, targets, composition_bias, overflow, stat);
 }
 
+// Returns true if the traceback matrices of the targets would exceed the cell limit for tracebacks in linear memory.
+// The limit is off by default and when a traceback mode is set explicitly.
+static bool use_checkpoint_traceback(const sequence& query, vector<DpTarget>::const_iterator begin, vector<DpTarget>::const_iterator end, DynamicIterator<DpTarget>* targets, int flags)
+{
+	if (config.linear_traceback_cells == 0)
+		return false;
+	size_t cells = 0;
+	if (flags & DP::FULL_MATRIX) {
+		int max_len = 0;
+		for (size_t i = 0; i < targets->count; ++i)
+			max_len = std::max(max_len, (int)(*targets)[i].seq.length());
+		cells = query.length() * (size_t)max_len;
+	}
+	else {
+		int band = 0, cols = 0;
+		for (vector<DpTarget>::const_iterator i = begin; i < end; ++i) {
+			band = std::max(band, i->band());
+			cols = std::max(cols, i->cols);
+		}
+		cells = (size_t)band * (size_t)cols;
+	}
+	return cells >= config.linear_traceback_cells;
+}
+
 template<typename _sv>
-list<Hsp> swipe_targets(const sequence &query,
+HspList swipe_targets(const sequence &query,
 	vector<DpTarget>::const_iterator begin,
 	vector<DpTarget>::const_iterator end,
 	DynamicIterator<DpTarget>* targets,
@@ -96,9 +121,11 @@ list<Hsp> swipe_targets(const sequence &query,
 	Statistics &stat)
 {
 	constexpr auto CHANNELS = vector<DpTarget>::const_iterator::difference_type(::DISPATCH_ARCH::ScoreTraits<_sv>::CHANNELS);
-	list<Hsp> out;
+	HspList out;
 	if (flags & DP::FULL_MATRIX) {
-		if (flags & TRACEBACK)
+		if ((flags & TRACEBACK) && use_checkpoint_traceback(query, begin, end, targets, flags))
+			return full_swipe_dispatch_cbs<_sv, CheckpointTraceback>(query, frame, *targets, composition_bias, overflow, stat);
+		else if (flags & TRACEBACK)
 			return full_swipe_dispatch_cbs<_sv, VectorTraceback>(query, frame, *targets, composition_bias, overflow, stat);
 		else
 			return full_swipe_dispatch_cbs<_sv, ScoreOnly>(query, frame, *targets, composition_bias, overflow, stat);
@@ -106,7 +133,10 @@ list<Hsp> swipe_targets(const sequence &query,
 	else {
 		for (vector<DpTarget>::const_iterator i = begin; i < end; i += CHANNELS) {
 			if (flags & TRACEBACK) {
-				if (config.traceback_mode == TracebackMode::VECTOR)
+				const vector<DpTarget>::const_iterator j = i + std::min(CHANNELS, end - i);
+				if (use_checkpoint_traceback(query, i, j, targets, flags))
+					out.splice(out.end(), swipe_dispatch_cbs<_sv, CheckpointTraceback>(query, frame, i, j, composition_bias, overflow, stat));
+				else if (config.traceback_mode == TracebackMode::VECTOR)
 					out.splice(out.end(), swipe_dispatch_cbs<_sv, VectorTraceback>(query, frame, i, i + std::min(CHANNELS, end - i), composition_bias, overflow, stat));
 				else
 					out.splice(out.end(), swipe_dispatch_cbs<_sv, Traceback>(query, frame, i, i + std::min(CHANNELS, end - i), composition_bias, overflow, stat));
@@ -127,7 +157,7 @@ void swipe_worker(const sequence *query,
 	Frame frame,
 	const int8_t *composition_bias,
 	int flags,
-	list<Hsp> *out,
+	HspList *out,
 	vector<DpTarget> *overflow,
 	Statistics *stat)
 {
@@ -145,7 +175,7 @@ void swipe_worker(const sequence *query,
 }
 
 template<typename _sv>
-list<Hsp> swipe_threads(const sequence &query,
+HspList swipe_threads(const sequence &query,
 	vector<DpTarget>::const_iterator begin,
 	vector<DpTarget>::const_iterator end,
 	DynamicIterator<DpTarget>* targets,
@@ -164,29 +194,16 @@ list<Hsp> swipe_threads(const sequence &query,
 	if (flags & PARALLEL) {
 		task_timer timer("Banded swipe (run)", config.target_parallel_verbosity);
 		const size_t n = config.threads_align ? config.threads_align : config.threads_;
-		vector<thread> threads;
-		vector<list<Hsp>> thread_out(n);
+		vector<HspList> thread_out(n);
 		vector<vector<DpTarget>> thread_overflow(n);
 		atomic<size_t> next(0);
-		for (size_t i = 0; i < n; ++i)
-			threads.emplace_back(
-				swipe_worker<_sv>,
-				&query,
-				begin,
-				end,
-				targets ? targets : my_targets.get(),
-				&next,
-				frame,
-				composition_bias,
-				flags,
-				&thread_out[i],
-				&thread_overflow[i],
-				&stat);
-		for (auto &t : threads)
-			t.join();
+		DynamicIterator<DpTarget>* target_it = targets ? targets : my_targets.get();
+		Util::Parallel::run_tasks(n, [&](size_t i) {
+			swipe_worker<_sv>(&query, begin, end, target_it, &next, frame, composition_bias, flags, &thread_out[i], &thread_overflow[i], &stat);
+		});
 		timer.go("Banded swipe (merge)");
-		list<Hsp> out;
-		for (list<Hsp> &l : thread_out)
+		HspList out;
+		for (HspList &l : thread_out)
 			out.splice(out.end(), l);
 		overflow.reserve(std::accumulate(thread_overflow.begin(), thread_overflow.end(), (size_t)0, [](size_t n, const vector<DpTarget> &v) { return n + v.size(); }));
 		for (const vector<DpTarget> &v : thread_overflow)
@@ -197,10 +214,10 @@ list<Hsp> swipe_threads(const sequence &query,
 		return swipe_targets<_sv>(query, begin, end, targets ? targets : my_targets.get(), frame, composition_bias, flags, overflow, stat);
 }
 
-list<Hsp> swipe(const sequence &query, vector<DpTarget> &targets8, vector<DpTarget> &targets16, DynamicIterator<DpTarget>* targets, Frame frame, const Bias_correction *composition_bias, int flags, Statistics &stat)
+HspList swipe(const sequence &query, vector<DpTarget> &targets8, vector<DpTarget> &targets16, DynamicIterator<DpTarget>* targets, Frame frame, const Bias_correction *composition_bias, int flags, Statistics &stat)
 {
 	vector<DpTarget> overflow8, overflow16, overflow32;
-	list<Hsp> out;
+	HspList out;
 	auto time_stat = (flags & TRACEBACK) ? Statistics::TIME_TRACEBACK_SW : Statistics::TIME_SW;
 #ifdef __SSE4_1__
 	if ((!targets8.empty() || targets) && config.cbs_matrix_scale < 16) {
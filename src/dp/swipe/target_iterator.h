@@ -37,7 +37,9 @@ struct TargetIterator
 	typedef ::DISPATCH_ARCH::SIMD::Vector<_t> SeqVector;
 	typedef ::DISPATCH_ARCH::score_vector<_t> ScoreVector;
 	enum {
-		CHANNELS = SeqVector::CHANNELS
+		CHANNELS = SeqVector::CHANNELS,
+		// Number of score row pointers filled by get(), the profile transposes at least 32 rows.
+		SCORE_ROWS = CHANNELS > 32 ? CHANNELS : 32
 	};
 
 	TargetIterator(vector<DpTarget>::const_iterator subject_begin, vector<DpTarget>::const_iterator subject_end, int i1, int qlen, int *d_begin) :
@@ -105,7 +107,7 @@ struct TargetIterator
 
 	const int8_t** get(const int8_t** target_scores) const {
 		static const int8_t blank[32] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-		std::fill(target_scores, target_scores + 32, blank);
+		std::fill(target_scores, target_scores + SCORE_ROWS, blank);
 		for (int i = 0; i < active.size(); ++i) {
 			const int channel = active[i];
 			const int l = (int)(*this)[channel];
@@ -147,11 +149,11 @@ struct TargetIterator
 		return true;
 	}
 
-	uint32_t cbs_mask() const {
-		uint32_t r = 0;
-		for (uint32_t i = 0; i < (uint32_t)n_targets; ++i)
+	uint64_t cbs_mask() const {
+		uint64_t r = 0;
+		for (int i = 0; i < n_targets; ++i)
 			if (subject_begin[i].adjusted_matrix())
-				r |= 1 << i;
+				r |= (uint64_t)1 << i;
 		return r;
 	}
 
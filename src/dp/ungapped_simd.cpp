@@ -28,8 +28,61 @@ using namespace DISPATCH_ARCH;
 
 namespace DP { namespace DISPATCH_ARCH {
 
+#if ARCH_ID == 3
+
+// Ungapped extension of up to 64 subjects in the channels of the 512 bit score_vector. The subjects are
+// transposed in two halves of 32 using the AVX2 transpose.
+static void window_ungapped_512(const Letter* query, const Letter** subjects, int subject_count, int window, int* out) {
+	typedef score_vector<int8_t> Sv;
+	constexpr int H = 32;
+	assert(subject_count > H && subject_count <= 2 * H);
+	const int n_hi = subject_count - H;
+
+	alignas(32) Letter subject_lo[H * H], subject_hi[H * H];
+	const Letter* ptr_lo[H], * ptr_hi[H], * query_end = query + window;
+	std::copy(subjects, subjects + H, ptr_lo);
+	std::copy(subjects + H, subjects + subject_count, ptr_hi);
+
+	Sv score, best;
+
+	for (int i = 0; i < window; i += H) {
+		transpose(ptr_lo, H, subject_lo, __m256i());
+		transpose(ptr_hi, n_hi, subject_hi, __m256i());
+		for (int j = 0; j < H && query < query_end; ++j, ++query) {
+			const __m512i seq = _mm512_inserti64x4(_mm512_castsi256_si512(_mm256_load_si256((const __m256i*)&subject_lo[j * H])),
+				_mm256_load_si256((const __m256i*)&subject_hi[j * H]), 1);
+			unsigned query_letter = unsigned(*query);
+#ifdef SEQ_MASK
+			query_letter &= (unsigned)LETTER_MASK;
+#endif
+			const Sv match(query_letter, seq);
+			score = score + match;
+			best = max(best, score);
+		}
+		for (int j = 0; j < H; ++j)
+			ptr_lo[j] += H;
+		for (int j = 0; j < n_hi; ++j)
+			ptr_hi[j] += H;
+	}
+
+	int8_t best2[2 * H];
+	best.store(best2);
+	for (int i = 0; i < H; ++i)
+		out[i] = ScoreTraits<Sv>::int_score(best2[i]);
+	const int d = 2 * H - n_hi;
+	for (int i = 0; i < n_hi; ++i)
+		out[H + i] = ScoreTraits<Sv>::int_score(best2[d + i]);
+}
+
+#endif
+
 void window_ungapped(const Letter *query, const Letter **subjects, int subject_count, int window, int *out) {
-#ifdef __SSE4_1__
+#if ARCH_ID == 3
+	if (subject_count > 32)
+		window_ungapped_512(query, subjects, subject_count, window, out);
+	else
+		::DP::ARCH_AVX2::window_ungapped(query, subjects, subject_count, window, out);
+#elif defined(__SSE4_1__)
 	typedef score_vector<int8_t> Sv;
 	typedef ::DISPATCH_ARCH::SIMD::Vector<int8_t> SeqV;
 	constexpr int CHANNELS = ::DISPATCH_ARCH::ScoreTraits<Sv>::CHANNELS;
@@ -74,9 +127,13 @@ void window_ungapped_best(const Letter* query, const Letter** subjects, int subj
 #ifdef __SSE4_1__
 	}
 #endif
-#if ARCH_ID == 2
+#if ARCH_ID >= 2
 	else if (subject_count <= 16)
 		::DP::ARCH_SSE4_1::window_ungapped(query, subjects, subject_count, window, out);
+#if ARCH_ID == 3
+	else if (subject_count > 32)
+		window_ungapped_512(query, subjects, subject_count, window, out);
+#endif
 	else
 		::DP::ARCH_AVX2::window_ungapped(query, subjects, subject_count, window, out);
 #elif defined(__SSE4_1__)
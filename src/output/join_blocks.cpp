@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../data/ref_dictionary.h"
 #include "../util/log_stream.h"
 #include "../align/global_ranking/global_ranking.h"
+#include "../util/parallel/thread_pool.h"
 
 using namespace std;
 
@@ -332,12 +333,10 @@ void join_blocks(unsigned ref_blocks, Consumer &master_out, const PtrVector<Temp
 		merged_query_list.reset(new TempFile());
 	JoinWriter writer(config.global_ranking_targets ? *merged_query_list : master_out);
 	Task_queue<TextBuffer, JoinWriter> queue(3 * config.threads_, writer);
-	vector<thread> threads;
 	BitVector ranking_db_filter(config.global_ranking_targets > 0 ? params.db_seqs : 0);
-	for (unsigned i = 0; i < config.threads_; ++i)
-		threads.emplace_back(join_worker, &queue, &params, &metadata, &ranking_db_filter);
-	for (auto &t : threads)
-		t.join();
+	Util::Parallel::run_tasks(config.threads_, [&](size_t) {
+		join_worker(&queue, &params, &metadata, &ranking_db_filter);
+	});
 	JoinFetcher::finish();
 	if (*output_format != Output_format::daa && config.report_unaligned != 0) {
 		TextBuffer out;
@@ -24,6 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <memory>
 #include <map>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include "../util/io/output_file.h"
 #include "../basic/packed_transcript.h"
 #include "../util/text_buffer.h"
@@ -162,16 +164,17 @@ struct IntermediateRecord
 void join_blocks(unsigned ref_blocks, Consumer &master_out, const PtrVector<TempFile> &tmp_file, const Parameters &params, const Metadata &metadata, DatabaseFile &db_file,
 					const vector<string> tmp_file_names = vector<string>());
 
+// Writes the output buffers of queries in query order. Buffers are published into a ring of slots
+// indexed by query number; whichever thread finds the slot of the next query filled takes over
+// writing until it reaches a gap. The ring size and the memory ceiling bound how far query
+// dispatch may run ahead of the oldest query still in flight (see wait_window).
 struct OutputSink
 {
-	OutputSink(size_t begin, Consumer *f) :
-		f_(f),
-		begin_(begin),
-		next_(begin),
-		size_(0),
-		max_size_(0)
-	{}
+	enum { CAPACITY = 1 << 16 };
+	OutputSink(size_t begin, Consumer *f, size_t memory_limit = SIZE_MAX);
 	void push(size_t n, TextBuffer *buf);
+	// Blocks until query n is inside the window of the ring and the buffered output is below the memory ceiling.
+	void wait_window(size_t n);
 	size_t size() const
 	{
 		return size_;
@@ -193,11 +196,25 @@ struct OutputSink
 	}
 	static std::unique_ptr<OutputSink> instance;
 private:
-	void flush(TextBuffer *buf);
-	std::mutex mtx_;
+	struct Slot {
+		Slot() :
+			buf(nullptr),
+			ready(false)
+		{}
+		TextBuffer* buf;
+		std::atomic<bool> ready;
+	};
+	template<typename _f>
+	void wait(_f blocked);
+	void flush();
 	Consumer* const f_;
-	std::map<size_t, TextBuffer*> backlog_;
-	size_t begin_, next_, size_, max_size_;
+	const size_t begin_, memory_limit_;
+	std::unique_ptr<Slot[]> slots_;
+	std::atomic<size_t> next_, size_, max_size_;
+	std::atomic<bool> flushing_;
+	std::atomic<int> waiters_;
+	std::mutex wait_mtx_;
+	std::condition_variable wait_cv_;
 };
 
 void heartbeat_worker(size_t qend);
@@ -28,48 +28,82 @@ using std::endl;
 
 std::unique_ptr<OutputSink> OutputSink::instance;
 
+OutputSink::OutputSink(size_t begin, Consumer *f, size_t memory_limit) :
+	f_(f),
+	begin_(begin),
+	memory_limit_(memory_limit),
+	slots_(new Slot[CAPACITY]),
+	next_(begin),
+	size_(0),
+	max_size_(0),
+	flushing_(false),
+	waiters_(0)
+{}
+
+template<typename _f>
+void OutputSink::wait(_f blocked)
+{
+	if (!blocked())
+		return;
+	++waiters_;
+	{
+		std::unique_lock<std::mutex> lock(wait_mtx_);
+		while (blocked())
+			wait_cv_.wait(lock);
+	}
+	--waiters_;
+}
+
+void OutputSink::wait_window(size_t n)
+{
+	wait([this, n]() {
+		const size_t next = next_;
+		return n > next && (n - next >= CAPACITY || size_ > memory_limit_);
+	});
+}
+
 void OutputSink::push(size_t n, TextBuffer *buf)
 {
-	mtx_.lock();
-	//cout << "n=" << n << " next=" << next_ << endl;
-	if (n != next_) {
-		backlog_[n] = buf;
-		size_ += buf ? buf->alloc_size() : 0;
-		max_size_ = std::max(max_size_, size_);
-		mtx_.unlock();
+	wait([this, n]() { return n - next_ >= CAPACITY; });
+	if (buf) {
+		const size_t size = (size_ += buf->alloc_size());
+		size_t max_size = max_size_;
+		while (size > max_size && !max_size_.compare_exchange_weak(max_size, size));
 	}
-	else
-		flush(buf);
+	Slot& slot = slots_[n & (CAPACITY - 1)];
+	slot.buf = buf;
+	slot.ready = true;
+	flush();
 }
 
-void OutputSink::flush(TextBuffer *buf)
+void OutputSink::flush()
 {
-	size_t n = next_ + 1;
-	vector<TextBuffer*> out;
-	out.push_back(buf);
-	std::map<size_t, TextBuffer*>::iterator i;
+	size_t n;
 	do {
-		while ((i = backlog_.begin()) != backlog_.end() && i->first == n) {
-			out.push_back(i->second);
-			backlog_.erase(i);
-			++n;
-		}
-		mtx_.unlock();
+		bool expected = false;
+		if (!flushing_.compare_exchange_strong(expected, true))
+			return;
+		n = next_;
 		size_t size = 0;
-		for (vector<TextBuffer*>::iterator j = out.begin(); j < out.end(); ++j) {
-			if (*j) {
-				f_->consume((*j)->get_begin(), (*j)->size());
-				if (*j != buf)
-					size += (*j)->alloc_size();
-				delete *j;
+		Slot* slot;
+		while ((slot = &slots_[n & (CAPACITY - 1)])->ready) {
+			TextBuffer* buf = slot->buf;
+			if (buf) {
+				f_->consume(buf->get_begin(), buf->size());
+				size += buf->alloc_size();
+				delete buf;
 			}
+			slot->ready = false;
+			next_ = ++n;
 		}
-		out.clear();
-		mtx_.lock();
 		size_ -= size;
-	} while ((i = backlog_.begin()) != backlog_.end() && i->first == n);
-	next_ = n;
-	mtx_.unlock();
+		flushing_ = false;
+		if (waiters_ > 0) {
+			std::lock_guard<std::mutex> lock(wait_mtx_);
+			wait_cv_.notify_all();
+		}
+		// A buffer for the next query may have been published after the scan but before the flag was released.
+	} while (slots_[n & (CAPACITY - 1)].ready);
 }
 
 void heartbeat_worker(size_t qend)
@@ -50,9 +50,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/system/system.h"
 #include "../align/target.h"
 #include "../data/enum_seeds.h"
+#include "../data/seed_index.h"
+#include "../data/block_loader.h"
+#include "../search/memory_plan.h"
+#include "../search/estimate.h"
+#include "../util/memory/pool_allocator.h"
 
 using std::unique_ptr;
 using std::endl;
+using std::cout;
 
 namespace Workflow { namespace Search {
 
@@ -79,6 +85,17 @@ string get_ref_block_tmpfile_name(size_t query, size_t block) {
 	return join_path(config.parallel_tmpdir, file_name);
 }
 
+// Histogram of the reference seeds, restricted to window minimizers in the compact index mode.
+template<typename _filter>
+static Partitioned_histogram ref_histogram(const _filter *filter)
+{
+	if (config.minimizer_window > 0) {
+		const Minimizer_filter<_filter> minimizers(filter, config.minimizer_window);
+		return Partitioned_histogram(*ref_seqs::data_, false, &minimizers);
+	}
+	return Partitioned_histogram(*ref_seqs::data_, false, filter);
+}
+
 void run_ref_chunk(DatabaseFile &db_file,
 	unsigned query_chunk,
 	pair<size_t, size_t> query_len_bounds,
@@ -86,7 +103,8 @@ void run_ref_chunk(DatabaseFile &db_file,
 	Consumer &master_out,
 	PtrVector<TempFile> &tmp_file,
 	const Parameters &params,
-	const Metadata &metadata)
+	const Metadata &metadata,
+	bool ref_masked)
 {
 	log_rss();
 
@@ -94,7 +112,7 @@ void run_ref_chunk(DatabaseFile &db_file,
 		ref_seqs_unmasked::data_ = new Sequence_set(*ref_seqs::data_);
 
 	task_timer timer;
-	if (config.masking == 1 && !config.no_ref_masking) {
+	if (config.masking == 1 && !config.no_ref_masking && !db_file.load_masked && !ref_masked) {
 		timer.go("Masking reference");
 		size_t n = mask_seqs(*ref_seqs::data_, Masking::get());
 		timer.finish();
@@ -109,17 +127,33 @@ void run_ref_chunk(DatabaseFile &db_file,
 		config.query_bins);
 
 	if (!config.swipe_all) {
-		timer.go("Building reference histograms");
-		if (config.algo == Config::query_indexed)
-			ref_hst = Partitioned_histogram(*ref_seqs::data_, false, query_seeds);
-		else if (query_seeds_hashed != 0)
-			ref_hst = Partitioned_histogram(*ref_seqs::data_, true, query_seeds_hashed);
-		else
-			ref_hst = Partitioned_histogram(*ref_seqs::data_, false, &no_filter);
+		timer.go("Checking reference seed index");
+		const bool ref_index = config.algo == Config::double_indexed && query_seeds_hashed == 0 && !query_sketch && !config.target_indexed && config.minimizer_window == 0
+			&& SeedIndex::available(db_file, current_ref_block, block_to_database_id, *ref_seqs::data_);
+		char *ref_buffer = nullptr;
+		if (ref_index) {
+			timer.finish();
+			log_stream << "Using reference seed index." << endl;
+		}
+		else {
+			timer.go("Building reference histograms");
+			if (config.algo == Config::query_indexed)
+				ref_hst = Partitioned_histogram(*ref_seqs::data_, false, query_seeds);
+			else if (query_seeds_hashed != 0)
+				ref_hst = Partitioned_histogram(*ref_seqs::data_, true, query_seeds_hashed);
+			else if (query_sketch) {
+				timer.go("Building reference seed sketch");
+				ref_sketch = new Seed_sketch(*ref_seqs::data_, config.freq_sd);
+				timer.go("Building reference histograms");
+				ref_hst = ref_histogram(ref_sketch);
+			}
+			else
+				ref_hst = ref_histogram(&no_filter);
 
-		timer.go("Allocating buffers");
-		char *ref_buffer = SeedArray::alloc_buffer(ref_hst);
-		timer.finish();
+			timer.go("Allocating buffers");
+			ref_buffer = SeedArray::alloc_buffer(ref_hst);
+			timer.finish();
+		}
 
 		Hashed_seed_set* target_seeds = nullptr;
 		if (config.target_indexed) {
@@ -128,12 +162,13 @@ void run_ref_chunk(DatabaseFile &db_file,
 			timer.finish();
 		}
 
-		for (unsigned i = 0; i < shapes.count(); ++i)
-			search_shape(i, query_chunk, query_buffer, ref_buffer, params, target_seeds);
+		search_shapes(query_chunk, query_buffer, ref_buffer, params, target_seeds, ref_index);
 
 		timer.go("Deallocating buffers");
 		delete[] ref_buffer;
 		delete target_seeds;
+		delete ref_sketch;
+		ref_sketch = nullptr;
 
 		timer.go("Clearing query masking");
 		Frequent_seeds::clear_masking(*query_seqs::data_);
@@ -170,6 +205,7 @@ void run_ref_chunk(DatabaseFile &db_file,
 	delete ref_ids::data_;
 	if (config.comp_based_stats == Stats::CBS::COMP_BASED_STATS_AND_MATRIX_ADJUST)
 		delete ref_seqs_unmasked::data_;
+	Util::Memory::FreeListPool::reset();
 	timer.finish();
 }
 
@@ -241,8 +277,16 @@ void run_query_chunk(DatabaseFile &db_file,
 	const pair<size_t, size_t> query_len_bounds = query_seqs::data_->len_bounds(shapes[0].length_);
 
 	if (!config.swipe_all && !config.target_indexed) {
-		timer.go("Building query histograms");
-		query_hst = Partitioned_histogram(*query_seqs::data_, false, &no_filter);
+		if (config.sketch_seed_filter && config.algo == Config::double_indexed && query_seeds_hashed == 0) {
+			timer.go("Building query seed sketch");
+			query_sketch = new Seed_sketch(*query_seqs::data_, config.freq_sd);
+			timer.go("Building query histograms");
+			query_hst = Partitioned_histogram(*query_seqs::data_, false, query_sketch);
+		}
+		else {
+			timer.go("Building query histograms");
+			query_hst = Partitioned_histogram(*query_seqs::data_, false, &no_filter);
+		}
 
 		timer.go("Allocating buffers");
 		query_buffer = SeedArray::alloc_buffer(query_hst);
@@ -260,6 +304,12 @@ void run_query_chunk(DatabaseFile &db_file,
 	Chunk chunk;
 	bool mp_last_chunk = false;
 
+	// The unmasked copy needed for matrix adjustment is taken after loading, so the stored masking is not used in that mode.
+	db_file.load_masked = config.masking == 1 && !config.no_ref_masking && config.comp_based_stats != Stats::CBS::COMP_BASED_STATS_AND_MATRIX_ADJUST
+		&& db_file.has_stored_masking();
+	if (db_file.load_masked && query_chunk == 0)
+		log_stream << "Using masking stored in the database." << endl;
+
 	log_rss();
 
 	if (config.multiprocessing) {
@@ -278,7 +328,7 @@ void run_query_chunk(DatabaseFile &db_file,
 			P->log("SEARCH BEGIN "+std::to_string(query_chunk)+" "+std::to_string(chunk.i));
 
 			db_file.load_seqs(&block_to_database_id, (size_t)(0), &ref_seqs::data_, &ref_ids::data_, true, options.db_filter ? options.db_filter : metadata.taxon_filter, true, chunk);
-			run_ref_chunk(db_file, query_chunk, query_len_bounds, query_buffer, master_out, tmp_file, params, metadata);
+			run_ref_chunk(db_file, query_chunk, query_len_bounds, query_buffer, master_out, tmp_file, params, metadata, false);
 
 			ReferenceDictionary::get().save_block(query_chunk, chunk.i);
 			ReferenceDictionary::get().clear_block(chunk.i);
@@ -294,19 +344,22 @@ void run_query_chunk(DatabaseFile &db_file,
 			log_rss();
 		}
 	} else {
-		for (current_ref_block = 0;
-			 db_file.load_seqs(&block_to_database_id, (size_t)(config.chunk_size*1e9), &ref_seqs::data_, &ref_ids::data_, true, options.db_filter ? options.db_filter : metadata.taxon_filter);
-			 ++current_ref_block) {
-			run_ref_chunk(db_file, query_chunk, query_len_bounds, query_buffer, master_out, tmp_file, params, metadata);
-		}
+		const bool mask = config.masking == 1 && !config.no_ref_masking && !db_file.load_masked
+			&& config.comp_based_stats != Stats::CBS::COMP_BASED_STATS_AND_MATRIX_ADJUST;
+		BlockLoader loader(db_file, options.db_filter ? options.db_filter : metadata.taxon_filter, config.prefetch_blocks, mask);
+		for (current_ref_block = 0; loader.next(); ++current_ref_block)
+			run_ref_chunk(db_file, query_chunk, query_len_bounds, query_buffer, master_out, tmp_file, params, metadata, loader.masked());
 		log_rss();
 	}
+	db_file.load_masked = false;
 
 	timer.go("Deallocating buffers");
 	delete[] query_buffer;
 	delete query_seeds;
+	delete query_sketch;
 	delete Extension::memory;
 	query_seeds = 0;
+	query_sketch = nullptr;
 
 	log_rss();
 
@@ -482,6 +535,9 @@ void master_thread(DatabaseFile *db_file, task_timer &total_timer, Metadata &met
 		aligned_file = unique_ptr<OutputFile>(new OutputFile(config.aligned_file));
 	timer.finish();
 
+	if (config.cbs_cache_size > 0.0)
+		Extension::target_matrix_cache = new Extension::TargetMatrixCache((size_t)(config.cbs_cache_size * 1e9), *db_file);
+
 	for (;; ++current_query_chunk) {
 		task_timer timer("Loading query sequences", true);
 
@@ -524,6 +580,13 @@ void master_thread(DatabaseFile *db_file, task_timer &total_timer, Metadata &met
 			P->delete_stack(stack_align_todo);
 	}
 
+	if (Extension::target_matrix_cache) {
+		if (config.cbs_cache_persist)
+			Extension::target_matrix_cache->save();
+		delete Extension::target_matrix_cache;
+		Extension::target_matrix_cache = nullptr;
+	}
+
 	if (query_file && !options.query_file) {
 		timer.go("Closing the input file");
 		query_file->front().close();
@@ -558,6 +621,132 @@ void master_thread(DatabaseFile *db_file, task_timer &total_timer, Metadata &met
 	print_warnings();
 }
 
+// Loads samples of the leading sequences of the database and the query file, which are set to nullptr if none
+// could be taken, and returns the input sizes of the search. The hit density is left at 0.
+static ::Search::Workload sample_workload(DatabaseFile &db_file, const Options &options, Sequence_set *&query_sample, Sequence_set *&ref_sample)
+{
+	const size_t SAMPLE_QUERY_LETTERS = 1000000, SAMPLE_REF_LETTERS = 4000000;
+	::Search::Workload w;
+	w.ref_letters = db_file.ref_header.letters;
+	w.ref_seqs = db_file.ref_header.sequences;
+	w.shapes = shape_config(config.index_mode ? config.index_mode : sensitivity_index_mode(config.sensitivity), config.shapes, config.shape_mask).count();
+	w.hit_density = 0.0;
+	const bool mask = config.masking == 1 && Masking::instance;
+
+	vector<uint32_t> block2db_id;
+	String_set<char, 0> *ref_sample_ids = nullptr;
+	ref_sample = query_sample = nullptr;
+	const bool silent = db_file.silent_load;
+	db_file.silent_load = true;
+	db_file.load_seqs(&block2db_id, SAMPLE_REF_LETTERS, &ref_sample, &ref_sample_ids, false);
+	db_file.silent_load = silent;
+	db_file.rewind();
+	if (ref_sample && mask && !config.no_ref_masking)
+		mask_seqs(*ref_sample, Masking::get());
+
+	if (options.self) {
+		w.query_letters = w.ref_letters;
+		w.query_seqs = w.ref_seqs;
+		query_sample = ref_sample;
+	}
+	else if (!options.query_file && config.query_file.size() == 1 && !config.query_file.front().empty()) {
+		const string& file_name = config.query_file.front();
+		list<TextInputFile> file;
+		file.emplace_back(file_name);
+		const Sequence_file_format *format = guess_format(file.front());
+		String_set<char, 0> *ids = nullptr;
+		Sequence_set *source_seqs = nullptr;
+		if (load_seqs(file.begin(), file.end(), *format, &query_sample, ids, &source_seqs, nullptr, SAMPLE_QUERY_LETTERS, config.qfilt, input_value_traits) > 0) {
+			delete ids;
+			delete source_seqs;
+			if (query_sample->letters() < SAMPLE_QUERY_LETTERS) {
+				w.query_letters = query_sample->letters();
+				w.query_seqs = query_sample->get_length();
+			}
+			else {
+				// Letters per byte of the file, assuming a compression ratio of 4 for gzip.
+				const double letters_per_byte = (align_mode.query_translated ? 2.0 : 1.0) * (ends_with(file_name, ".gz") ? 4.0 : 1.0);
+				w.query_letters = size_t(file_size(file_name.c_str()) * letters_per_byte);
+				w.query_seqs = w.query_letters / std::max(query_sample->avg_len(), (size_t)1);
+			}
+			if (mask)
+				mask_seqs(*query_sample, Masking::get());
+		}
+		else
+			query_sample = nullptr;
+		file.front().close();
+	}
+	if (!query_sample) {
+		// Size of the query input is unknown, plan for full query blocks.
+		w.query_letters = std::numeric_limits<size_t>::max() / 2;
+		w.query_seqs = w.query_letters / 300;
+	}
+	return w;
+}
+
+static void delete_samples(Sequence_set *query_sample, Sequence_set *ref_sample)
+{
+	if (query_sample != ref_sample)
+		delete query_sample;
+	delete ref_sample;
+}
+
+// Sets the block size, index chunks, query bins and trace point fetch size that were not given by the user so that
+// the peak memory use predicted from the input sizes and a sample of the seed hits stays within --memory-budget.
+static void plan_memory(DatabaseFile &db_file, const Options &options)
+{
+	task_timer timer("Sampling seed hits for memory planning", 1);
+	double budget = config.memory_budget * 1e9;
+	const double ram = total_ram() * 1e9;
+	if (ram > 0.0 && budget > ram) {
+		budget = ram;
+		log_stream << "Memory budget exceeds the RAM of the host system, using " << ram / 1e9 << " GB." << endl;
+	}
+
+	Sequence_set *query_sample, *ref_sample;
+	::Search::Workload w = sample_workload(db_file, options, query_sample, ref_sample);
+	if (ref_sample && query_sample)
+		w.hit_density = ::Search::sample_hit_density(*query_sample, *ref_sample,
+			shape_config(config.index_mode ? config.index_mode : sensitivity_index_mode(config.sensitivity), config.shapes, config.shape_mask));
+	delete_samples(query_sample, ref_sample);
+	timer.finish();
+	log_stream << "Seed hit density = " << w.hit_density << endl;
+
+	const ::Search::MemoryPlan plan = ::Search::plan_memory(w, budget);
+	Config::set_option(config.chunk_size, plan.block_size);
+	Config::set_option(config.lowmem, plan.index_chunks);
+	Config::set_option(config.query_bins, plan.query_bins);
+	Config::set_option(config.trace_pt_fetch_size, plan.trace_pt_fetch_size, (size_t)10e9);
+	message_stream << "Memory plan: " << ::Search::MemoryPlan(w, config.chunk_size, config.lowmem, config.query_bins, config.trace_pt_fetch_size) << endl;
+	if (plan.rss() > budget)
+		message_stream << "Warning: no parameters found to keep the predicted memory use below the budget of " << budget / 1e9 << " GB." << endl;
+}
+
+// Dry run of the search (--estimate): runs the seed search on samples of the input and prints the predicted resource use.
+static void estimate(DatabaseFile &db_file, const Options &options)
+{
+	if (config.algo == Config::query_indexed || config.swipe_all || config.target_indexed || config.multiprocessing)
+		throw std::runtime_error("--estimate is only supported for the default double-indexed search.");
+	task_timer timer("Loading input samples");
+	Sequence_set *query_sample, *ref_sample;
+	const ::Search::Workload w = sample_workload(db_file, options, query_sample, ref_sample);
+	if (!query_sample || !ref_sample) {
+		delete_samples(query_sample, ref_sample);
+		throw std::runtime_error("--estimate requires a single query file and a non-empty database.");
+	}
+	timer.finish();
+	cout << "Query letters = " << w.query_letters << " (" << (query_sample->letters() == w.query_letters ? "exact" : "estimated from the file size")
+		<< "), reference letters = " << w.ref_letters << endl;
+	message_stream << "Sample letters: query = " << query_sample->letters() << ", reference = " << ref_sample->letters() << endl;
+
+	config.algo = Config::double_indexed;
+	setup_search();
+	const ::Search::Estimate e = ::Search::estimate(w, *query_sample, *ref_sample);
+	delete_samples(query_sample, ref_sample);
+	cout << "Block size = " << (size_t)(config.chunk_size * 1e9) << ", index chunks = " << config.lowmem << ", query bins = " << config.query_bins << endl;
+	cout << e << endl;
+}
+
 void run(const Options &options)
 {
 	task_timer total;
@@ -566,14 +755,27 @@ void run(const Options &options)
 
 	message_stream << "Temporary directory: " << TempFile::get_temp_dir() << endl;
 
+	task_timer timer("Opening the database", 1);
+	DatabaseFile *db_file = options.db ? options.db : DatabaseFile::auto_create_from_fasta();
+	timer.finish();
+
+	if (config.memory_budget > 0.0)
+		plan_memory(*db_file, options);
+
 	if (config.sensitivity >= Sensitivity::VERY_SENSITIVE)
 		Config::set_option(config.chunk_size, 0.4);
 	else
 		Config::set_option(config.chunk_size, 2.0);
 
-	task_timer timer("Opening the database", 1);
-	DatabaseFile *db_file = options.db ? options.db : DatabaseFile::auto_create_from_fasta();
-	timer.finish();
+	if (config.estimate) {
+		estimate(*db_file, options);
+		if (!options.db) {
+			db_file->close();
+			delete db_file;
+		}
+		message_stream << "Total time = " << total.get() << "s" << endl;
+		return;
+	}
 
 	init_output(db_file->has_taxon_id_lists(), db_file->has_taxon_nodes(), db_file->has_taxon_scientific_names());
 
@@ -35,6 +35,7 @@ void run_masker();
 void fastq2fasta();
 void view();
 void db_info();
+void make_seed_index();
 void test_main();
 void benchmark_sw();
 void test_io();
@@ -75,6 +76,9 @@ int main(int ac, const char* av[])
 		case Config::makedb:
 			make_db();
 			break;
+		case Config::makeidx:
+			make_seed_index();
+			break;
 		case Config::blastp:
 		case Config::blastx:
 			Workflow::Search::run(Workflow::Search::Options());
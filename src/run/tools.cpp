@@ -320,9 +320,59 @@ void reverse() {
 	in.close();
 }
 
+// Adjusts the matrix for the first sequence of the input file against each of the remaining sequences, using the
+// solver for single targets and the batched solver.
+static void benchmark_cbs() {
+	TextInputFile in(config.query_file.front());
+	string id;
+	vector<Letter> seq;
+	vector<vector<Letter>> seqs;
+	while (FASTA_format().get_seq(id, seq, in, value_traits))
+		seqs.push_back(seq);
+	in.close();
+	if (seqs.size() < 2)
+		throw std::runtime_error("The benchmark requires at least two sequences.");
+
+	const sequence query(seqs.front());
+	const Stats::Composition query_comp = Stats::composition(query);
+	const int query_len = Stats::count_true_aa(query);
+	const size_t n = seqs.size() - 1;
+	vector<Stats::Composition> target_comp;
+	vector<int> target_len;
+	for (size_t i = 1; i < seqs.size(); ++i) {
+		target_comp.push_back(Stats::composition(sequence(seqs[i])));
+		target_len.push_back(Stats::count_true_aa(sequence(seqs[i])));
+	}
+
+	high_resolution_clock::time_point t1 = high_resolution_clock::now();
+	vector<int> scalar;
+	for (size_t i = 0; i < n; ++i) {
+		const vector<int> m = Stats::CompositionMatrixAdjust(query_len, target_len[i], query_comp.data(), target_comp[i].data(), config.cbs_matrix_scale, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs());
+		scalar.insert(scalar.end(), m.begin(), m.end());
+	}
+	const double t_scalar = (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / 1e6;
+
+	t1 = high_resolution_clock::now();
+	const vector<int> batch = Stats::CompositionMatrixAdjust(query_len, query_comp.data(), n, target_len.data(), target_comp.data(), config.cbs_matrix_scale, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs());
+	const double t_batch = (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / 1e6;
+
+	size_t diff = 0;
+	for (size_t i = 0; i < scalar.size(); ++i)
+		if (scalar[i] != batch[i])
+			++diff;
+	cout << "Matrix adjustments:\t" << n << endl;
+	cout << "Single target solver:\t" << (double)n / t_scalar << " adjustments/s" << endl;
+	cout << "Batched solver:\t" << (double)n / t_batch << " adjustments/s" << endl;
+	cout << "Differing scores:\t" << diff << "/" << scalar.size() << endl;
+}
+
 void show_cbs() {
 	score_matrix = Score_matrix("BLOSUM62", config.gap_open, config.gap_extend, config.frame_shift, 1);
 	init_cbs();
+	if (config.type == "benchmark") {
+		benchmark_cbs();
+		return;
+	}
 	TextInputFile in(config.query_file.front());
 	string id;
 	vector<Letter> seq;
@@ -0,0 +1,160 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "estimate.h"
+#include "search.h"
+#include "trace_pt_buffer.h"
+#include "../basic/config.h"
+#include "../data/queries.h"
+#include "../data/reference.h"
+#include "../data/seed_array.h"
+#include "../data/frequent_seeds.h"
+#include "../util/parallel/thread_pool.h"
+#include "../util/parallel/node_queue.h"
+
+using std::vector;
+using std::endl;
+
+namespace Search {
+
+// The sample is searched on every CHUNK_STRIDE-th chunk of CHUNK_SIZE seed partitions.
+static const unsigned CHUNK_SIZE = Const::seedp / 64, CHUNK_STRIDE = 4, SAMPLED_CHUNKS = Const::seedp / CHUNK_SIZE / CHUNK_STRIDE;
+
+// CPU time in seconds of the extension stage per trace point, measured on a single thread searching 1,600 queries against
+// 3,000 related sequences. The more sensitive modes report more trace points per target, which share the per-target
+// work, so the time per trace point is lower.
+static double extension_time_per_trace_pt() {
+	switch (config.sensitivity) {
+	case Sensitivity::FAST:
+	case Sensitivity::DEFAULT:
+		return 7e-6;
+	case Sensitivity::MID_SENSITIVE:
+		return 4.5e-6;
+	default:
+		return 4e-6;
+	}
+}
+
+std::ostream& operator<<(std::ostream& s, const Estimate& e) {
+	s << "Predicted seed hits = " << e.seed_hits << " (stage 1 = " << e.stage1_hits << ", stage 2 = " << e.stage2_hits
+		<< ", trace points = " << e.trace_pts << ")" << endl;
+	s << "Predicted wall time = " << e.wall_time() << "s (seed index = " << e.seed_index_time << "s, seed search = "
+		<< e.seed_search_time << "s, extension = " << e.extension_time << "s)" << endl;
+	s << "Predicted peak memory = " << e.rss / 1e9 << " GB" << endl;
+	s << "Predicted temporary disk space (search) = " << e.temp_space / (1 << 30) << " GB";
+	return s;
+}
+
+Estimate estimate(const Workload& w, Sequence_set& query, Sequence_set& ref) {
+	// The sample is searched as a chunked index, so that seed hits already found in a preceding chunk are skipped and every
+	// trace point is reported in exactly one chunk. As chunks at the start of the partition range report more hits than later
+	// ones, the sampled chunks are spread evenly over it. The fixed seed makes repeated estimates agree.
+	std::default_random_engine rng(0);
+	const unsigned offset = std::uniform_int_distribution<unsigned>(0, CHUNK_STRIDE - 1)(rng);
+
+	query_seqs::data_ = &query;
+	ref_seqs::data_ = &ref;
+	Trace_pt_buffer::instance = new Trace_pt_buffer(query.get_length() / align_mode.query_contexts, config.tmpdir, config.query_bins);
+	statistics.reset();
+
+	task_timer timer("Building seed histograms");
+	const Partitioned_histogram query_hst(query, false, &no_filter), ref_hst(ref, false, &no_filter);
+	char *query_buffer = SeedArray::alloc_buffer(query_hst), *ref_buffer = SeedArray::alloc_buffer(ref_hst);
+	DoubleArray<SeedArray::_pos> query_seed_hits[Const::seedp], ref_seed_hits[Const::seedp];
+	double index_time = 0.0, search_time = 0.0;
+	timer.finish();
+
+	for (unsigned sid = 0; sid < shapes.count(); ++sid) {
+		timer.go("Searching seed partition sample");
+		const vector<uint32_t> patterns = shapes.patterns(0, sid + 1);
+		const Context context{ {patterns.data(), patterns.data() + patterns.size() - 1 },
+			{patterns.data(), patterns.data() + patterns.size() },
+			config.ungapped_evalue,
+			config.ungapped_evalue_short,
+			score_matrix.rawscore(config.short_query_ungapped_bitscore),
+			true
+		};
+		for (unsigned chunk = 0; chunk < SAMPLED_CHUNKS; ++chunk) {
+			const unsigned begin = (chunk * CHUNK_STRIDE + offset) * CHUNK_SIZE;
+			const SeedPartitionRange range(begin, begin + CHUNK_SIZE);
+			current_range = range;
+
+			task_timer stage_timer;
+			SeedArray ref_idx(ref, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, &no_filter),
+				query_idx(query, sid, query_hst.get(sid), range, query_hst.partition(), query_buffer, &no_filter);
+			Util::Parallel::NodeLocalQueue join_queue(range.begin(), range.end());
+			Util::Parallel::run_tasks(config.threads_, [&](size_t) {
+				seed_join_worker(&query_idx, &ref_idx, &join_queue, query_seed_hits, ref_seed_hits);
+			});
+			frequent_seeds.build(sid, range, query_seed_hits, ref_seed_hits);
+			index_time += stage_timer.get();
+
+			stage_timer.go();
+			Util::Parallel::NodeLocalQueue search_queue(range.begin(), range.end());
+			Util::Parallel::run_tasks(config.threads_, [&](size_t i) {
+				search_worker(&search_queue, sid, i, query_seed_hits, ref_seed_hits, &context);
+			});
+			search_time += stage_timer.get();
+		}
+	}
+	timer.finish();
+
+	const double sample_trace_pts = (double)Trace_pt_buffer::instance->count(),
+		trace_pt_size = sample_trace_pts > 0 ? Trace_pt_buffer::instance->data_size() / sample_trace_pts : sizeof(hit);
+	delete Trace_pt_buffer::instance;
+	Trace_pt_buffer::instance = nullptr;
+	delete[] query_buffer;
+	delete[] ref_buffer;
+	query_seqs::data_ = nullptr;
+	ref_seqs::data_ = nullptr;
+
+	const double q = (double)query.letters(), r = (double)ref.letters(),
+		fraction = 1.0 / CHUNK_STRIDE,
+		hit_factor = (double)w.query_letters / q * (double)w.ref_letters / r / fraction,
+		block_size = config.chunk_size * 1e9,
+		query_blocks = std::ceil(w.query_letters / block_size),
+		ref_blocks = std::ceil(w.ref_letters / block_size);
+	log_stream << "Sample seed hits = " << statistics.get(Statistics::SEED_HITS) << ", trace points = " << sample_trace_pts
+		<< ", bytes per trace point = " << trace_pt_size << endl;
+
+	Estimate e;
+	e.seed_hits = statistics.get(Statistics::SEED_HITS) * hit_factor;
+	e.stage1_hits = statistics.get(Statistics::TENTATIVE_MATCHES1) * hit_factor;
+	e.stage2_hits = statistics.get(Statistics::TENTATIVE_MATCHES2) * hit_factor;
+	e.trace_pts = sample_trace_pts * hit_factor;
+	// Building the seed arrays of an index chunk enumerates the seeds of all sequences. Every pair of query and reference
+	// blocks builds the seed arrays of both blocks for each index chunk.
+	e.seed_index_time = index_time / (SAMPLED_CHUNKS * (q + r)) * config.lowmem * (ref_blocks * w.query_letters + query_blocks * w.ref_letters);
+	e.seed_search_time = search_time * hit_factor;
+	e.extension_time = e.trace_pts * extension_time_per_trace_pt() / config.threads_;
+
+	Workload sampled = w;
+	sampled.hit_density = statistics.get(Statistics::SEED_HITS) / (double)shapes.count() / (q * r * fraction);
+	e.rss = MemoryPlan(sampled, config.chunk_size, config.lowmem, config.query_bins, config.trace_pt_fetch_size).rss();
+	// The trace points of one pair of blocks that exceed the memory buffer are written to disk.
+	e.temp_space = std::max(e.trace_pts / (query_blocks * ref_blocks) * trace_pt_size - config.trace_pt_membuf * 1e9, 0.0);
+	statistics.reset();
+	return e;
+}
+
+}
@@ -0,0 +1,50 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <ostream>
+#include "memory_plan.h"
+
+namespace Search {
+
+// Resource use of a search extrapolated from a sample of its input.
+struct Estimate {
+
+	double wall_time() const {
+		return seed_index_time + seed_search_time + extension_time;
+	}
+
+	// Predicted filter stage counts for the whole search.
+	double seed_hits, stage1_hits, stage2_hits, trace_pts;
+	// Predicted wall time in seconds of building the seed arrays and computing the hash joins, of the
+	// ungapped seed hit filters and of the extension stage.
+	double seed_index_time, seed_search_time, extension_time;
+	// Predicted peak memory and temporary disk space of the search (SEARCH_TEMP_SPACE), in bytes.
+	double rss, temp_space;
+
+	friend std::ostream& operator<<(std::ostream& s, const Estimate& e);
+
+};
+
+// Runs the seed search on a random subset of the seed partitions of the query and reference samples and
+// extrapolates the result to the input sizes of the workload. The samples are masked in place by the frequent seed filter.
+Estimate estimate(const Workload& w, Sequence_set& query, Sequence_set& ref);
+
+}
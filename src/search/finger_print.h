@@ -69,6 +69,32 @@ struct Byte_finger_print_64
 
 #endif
 
+#ifdef __AVX512BW__
+
+// 48 letter fingerprint held in a single 512 bit register. The masked load does not touch the
+// upper 16 bytes and the masked compare ignores them, so one compare replaces the three of the SSE version.
+struct Byte_finger_print_48_512
+{
+	static constexpr __mmask64 MASK = 0xffffffffffffllu;
+	Byte_finger_print_48_512(const Letter* q) :
+#ifdef SEQ_MASK
+		r1(letter_mask(_mm512_maskz_loadu_epi8(MASK, q - 16)))
+#else
+		r1(_mm512_maskz_loadu_epi8(MASK, q - 16))
+#endif
+	{}
+	unsigned match(const Byte_finger_print_48_512& rhs) const
+	{
+		return popcount64(_mm512_mask_cmpeq_epi8_mask(MASK, r1, rhs.r1));
+	}
+	bool operator==(const Byte_finger_print_48_512& rhs) const {
+		return match(rhs) >= config.min_identities;
+	}
+	__m512i r1;
+};
+
+#endif
+
 #ifdef __SSE2__
 
 struct Byte_finger_print_48
@@ -130,8 +156,13 @@ struct Byte_finger_print_48
 
 #endif
 
-#ifdef __AVX2__
+#ifdef __AVX512BW__
+typedef Byte_finger_print_48_512 Finger_print;
+#elif defined(__AVX2__)
 typedef Byte_finger_print_48 Finger_print;
 #else
 typedef Byte_finger_print_48 Finger_print;
-#endif
\ No newline at end of file
+#endif
+
+// Alignment of containers holding fingerprints.
+constexpr size_t FINGER_PRINT_ALIGN = alignof(Finger_print) < 16 ? 16 : alignof(Finger_print);
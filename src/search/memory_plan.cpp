@@ -0,0 +1,167 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <unordered_map>
+#include <algorithm>
+#include "memory_plan.h"
+#include "trace_pt_buffer.h"
+#include "../basic/config.h"
+#include "../basic/reduction.h"
+#include "../data/seed_array.h"
+#include "../stats/cbs.h"
+
+using std::vector;
+
+namespace Search {
+
+// Bytes per sequence for identifiers, limits and padding.
+static const double SEQ_OVERHEAD = 64.0;
+// Thread local buffers of the search and alignment stages.
+static const double THREAD_MEMORY = 64e6;
+static const size_t MAX_SAMPLED_SHAPES = 2, MAX_INDEX_CHUNKS = 16, MAX_QUERY_BINS = 1024, MIN_FETCH_SIZE = 1000000;
+static const double BLOCK_SIZES[] = { 12.0, 8.0, 6.0, 4.0, 2.0, 1.0, 0.4, 0.2, 0.1 };
+
+// Fraction of seed hits that pass the ungapped filters and are stored as trace points, i.e. the ratio of the hits of
+// filter stage 3 to those of stage 0 in the --log statistics. The values were measured with queries drawn from the
+// reference database (10% for the default mode, 2.3% mid-sensitive, 1% sensitive to very-sensitive, 0.2%
+// ultra-sensitive). Unrelated sequences yield far fewer trace points, so the values are upper bounds for planning.
+static double trace_pt_fraction() {
+	switch (config.sensitivity) {
+	case Sensitivity::FAST:
+	case Sensitivity::DEFAULT:
+		return 0.1;
+	case Sensitivity::MID_SENSITIVE:
+		return 0.025;
+	case Sensitivity::ULTRA_SENSITIVE:
+		return 0.0025;
+	default:
+		return 0.01;
+	}
+}
+
+double ref_block_memory(double letters, double avg_len) {
+	double m = letters * (1.0 + SEQ_OVERHEAD / avg_len);
+	if (config.comp_based_stats == Stats::CBS::COMP_BASED_STATS_AND_MATRIX_ADJUST)
+		m += letters;
+	return m;
+}
+
+MemoryPlan::MemoryPlan(const Workload& w, double block_size, unsigned index_chunks, unsigned query_bins, size_t trace_pt_fetch_size) :
+	block_size(block_size),
+	index_chunks(index_chunks),
+	query_bins(query_bins),
+	trace_pt_fetch_size(trace_pt_fetch_size)
+{
+	const double b = block_size * 1e9,
+		q = std::min(b, (double)w.query_letters),
+		r = std::min(b, (double)w.ref_letters),
+		q_avg_len = w.query_seqs ? (double)w.query_letters / w.query_seqs : 300.0,
+		r_avg_len = w.ref_seqs ? (double)w.ref_letters / w.ref_seqs : 300.0,
+		c = index_chunks;
+	seqs = q * (1.0 + SEQ_OVERHEAD / q_avg_len) + ref_block_memory(r, r_avg_len);
+
+	// Seed arrays of one index chunk, and the query and reference positions of the seeds joined between them.
+	const double seed_hits = w.hit_density * q * r / c;
+	search = (q + r) / c * sizeof(SeedArray::Entry)
+		+ (std::min(seed_hits, q / c) + std::min(seed_hits, r / c)) * sizeof(Packed_loc);
+	trace_pts = w.hit_density * q * r * w.shapes * trace_pt_fraction();
+	search += std::min(config.trace_pt_membuf * 1e9, trace_pts * sizeof(hit));
+
+	// The alignment stage loads query bins until the fetch size is reached, and needs a second buffer for sorting.
+	// Output buffered ahead of the slowest query may take up to the --output-membuf ceiling.
+	const double fetch = std::min(b * 10 * 2 / c / 3, (double)trace_pt_fetch_size),
+		loaded = std::max(trace_pts / query_bins, std::min(trace_pts, fetch));
+	align = loaded * sizeof(hit) * 2 + config.output_membuf * 1e9;
+
+	threads = THREAD_MEMORY * config.threads_;
+}
+
+std::ostream& operator<<(std::ostream& s, const MemoryPlan& p) {
+	s << "block size = " << p.block_size << ", index chunks = " << p.index_chunks << ", query bins = " << p.query_bins
+		<< ", trace point fetch size = " << p.trace_pt_fetch_size << ", predicted peak memory = " << p.rss() / 1e9 << " GB"
+		<< " (sequences = " << p.seqs / 1e9 << " GB, seed search = " << p.search / 1e9 << " GB, alignment = " << p.align / 1e9 << " GB)";
+	return s;
+}
+
+// Calls f for the key of every seed of the shape in the sequences.
+template<typename _f>
+static void enum_seeds(const Sequence_set& seqs, const Shape& shape, _f f) {
+	const Reduction& reduction = Reduction::reduction;
+	for (size_t i = 0; i < seqs.get_length(); ++i) {
+		const sequence seq = seqs[i];
+		for (size_t j = 0; j + shape.length_ <= seq.length(); ++j) {
+			uint64_t key = 0;
+			unsigned k = 0;
+			for (; k < shape.weight_; ++k) {
+				const Letter l = letter_mask(seq[j + shape.positions_[k]]);
+				if (!is_amino_acid(l))
+					break;
+				key = key * reduction.size() + reduction(l);
+			}
+			if (k == shape.weight_)
+				f(key);
+		}
+	}
+}
+
+double sample_hit_density(const Sequence_set& query, const Sequence_set& ref, const shape_config& shapes) {
+	const size_t n = std::min((size_t)shapes.count(), MAX_SAMPLED_SHAPES);
+	if (n == 0 || query.letters() == 0 || ref.letters() == 0)
+		return 0.0;
+	double hits = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		std::unordered_map<uint64_t, uint32_t> counts;
+		enum_seeds(query, shapes[i], [&counts](uint64_t key) { ++counts[key]; });
+		enum_seeds(ref, shapes[i], [&counts, &hits](uint64_t key) {
+			auto it = counts.find(key);
+			if (it != counts.end())
+				hits += it->second;
+		});
+	}
+	return hits / n / ((double)query.letters() * (double)ref.letters());
+}
+
+MemoryPlan plan_memory(const Workload& w, double budget) {
+	const double max_block = std::max(w.query_letters, w.ref_letters) / 1e9;
+	const size_t default_fetch = config.trace_pt_fetch_size;
+	const size_t n = sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]);
+	for (size_t i = 0; i < n; ++i) {
+		const double b = BLOCK_SIZES[i];
+		// Block sizes above the size of the input all behave the same, so only the smallest of them is considered.
+		if (i + 1 < n && BLOCK_SIZES[i + 1] >= max_block)
+			continue;
+		for (unsigned c = 1; c <= MAX_INDEX_CHUNKS; c *= 2) {
+			const MemoryPlan base(w, b, c, 1, default_fetch);
+			const double avail = budget - base.seqs - base.threads;
+			if (avail <= 0)
+				break;
+			const size_t fetch = std::max(std::min(default_fetch, size_t(avail / (2 * sizeof(hit)))), MIN_FETCH_SIZE);
+			unsigned bins = 16;
+			while (bins < MAX_QUERY_BINS && base.trace_pts / bins * 2 * sizeof(hit) > avail)
+				bins *= 2;
+			const MemoryPlan plan(w, b, c, bins, fetch);
+			if (plan.rss() <= budget)
+				return plan;
+		}
+	}
+	return MemoryPlan(w, BLOCK_SIZES[n - 1], MAX_INDEX_CHUNKS, MAX_QUERY_BINS, MIN_FETCH_SIZE);
+}
+
+}
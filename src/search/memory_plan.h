@@ -0,0 +1,67 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stddef.h>
+#include <ostream>
+#include "../basic/shape_config.h"
+#include "../data/sequence_set.h"
+
+namespace Search {
+
+// Input sizes of a search that the memory use depends on.
+struct Workload {
+	size_t query_letters, query_seqs, ref_letters, ref_seqs;
+	unsigned shapes;
+	// Seed hits per pair of query and reference letters for a single shape.
+	double hit_density;
+};
+
+// Block size, index chunks and query bins of a search together with the memory use predicted for them.
+struct MemoryPlan {
+
+	MemoryPlan(const Workload& w, double block_size, unsigned index_chunks, unsigned query_bins, size_t trace_pt_fetch_size);
+
+	double rss() const {
+		return seqs + std::max(search, align) + threads;
+	}
+
+	double block_size;
+	unsigned index_chunks, query_bins;
+	size_t trace_pt_fetch_size;
+	// Predicted trace points per pair of query and reference block.
+	double trace_pts;
+	// Predicted memory use in bytes of the loaded sequences, the seed search, the alignment stage and the thread local buffers.
+	double seqs, search, align, threads;
+
+	friend std::ostream& operator<<(std::ostream& s, const MemoryPlan& p);
+
+};
+
+// Predicted memory use in bytes of a loaded reference block with the given number of letters and average sequence length.
+double ref_block_memory(double letters, double avg_len);
+// Measures the seed hit density on samples of the query and reference sequences using the first shapes of the configuration
+// and the reduced alphabet in Reduction::reduction.
+double sample_hit_density(const Sequence_set& query, const Sequence_set& ref, const shape_config& shapes);
+// Chooses the largest block size and smallest number of index chunks and query bins that keep the predicted memory use
+// below the budget (in bytes). Returns the plan of the smallest block size if none fits.
+MemoryPlan plan_memory(const Workload& w, double budget);
+
+}
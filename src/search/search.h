@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include <stddef.h>
+#include <algorithm>
 #include "../util/simd.h"
 #include "../dp/ungapped.h"
 #include "../basic/shape_config.h"
@@ -31,6 +32,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/scores/cutoff_table.h"
 #include "../basic/parameters.h"
 #include "../data/seed_set.h"
+#include "../data/seed_array.h"
+#include "../util/data_structures/double_array.h"
+
+namespace Util { namespace Parallel { struct NodeLocalQueue; }}
 
 // #define UNGAPPED_SPOUGE
 
@@ -44,6 +49,8 @@ struct Context {
 	const Util::Scores::CutoffTable cutoff_table, cutoff_table_short;
 #endif
 	const int short_query_ungapped_cutoff;
+	// The seed index is split into chunks of seed partitions, so hits of seeds in other chunks have to be verified.
+	const bool chunked;
 };
 
 }
@@ -68,13 +75,50 @@ struct Stage1_hit
 	unsigned q, s;
 };
 
-void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *ref_buffer, const Parameters &params, const Hashed_seed_set* target_seeds);
+void seed_join_worker(SeedArray *query_seeds, SeedArray *ref_seeds, Util::Parallel::NodeLocalQueue *seedp, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seeds_hits);
+void search_worker(Util::Parallel::NodeLocalQueue *seedp, unsigned shape, size_t thread_id, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, const Search::Context *context);
+void search_shapes(unsigned query_block, char *query_buffer, char *ref_buffer, const Parameters &params, const Hashed_seed_set* target_seeds, bool ref_index);
 bool use_single_indexed(double coverage, size_t query_letters, size_t ref_letters);
 void setup_search();
+unsigned sensitivity_index_mode(Sensitivity sensitivity);
 void setup_search_cont();
 
 namespace Search {
 
+// Computes the best ungapped window scores of the query against the subjects in batches of the SIMD width.
+// With prefetch, the subject windows of the next batch are prefetched while the current one is scored.
+DECL_DISPATCH(void, window_ungapped_batches, (const Letter* query, const Letter** subjects, size_t subject_count, int window, int* out, bool prefetch))
+
+static inline void prefetch_window(const Letter* p, int len) {
+#ifdef __SSE__
+	const char* end = (const char*)p + len;
+	for (const char* c = (const char*)p; c < end; c += 64)
+		_mm_prefetch(c, _MM_HINT_T0);
+	_mm_prefetch(end - 1, _MM_HINT_T0);
+#endif
+}
+
+// Prefetches the subject windows of a contiguous range of stage 1 hits up to DISTANCE hits ahead of the hit list
+// about to be scored. The hit lists of most query offsets are shorter than a SIMD batch, so the prefetches run
+// across the boundaries of the query offsets. _f maps a hit to the start of its subject window.
+template<typename _f>
+struct WindowPrefetcher {
+	enum { DISTANCE = 64 };
+	WindowPrefetcher(const uint32_t* begin, const uint32_t* end, int window, _f window_begin):
+		next_(begin),
+		end_(end),
+		window_(window),
+		window_begin_(window_begin)
+	{}
+	void advance(const uint32_t* list_end) {
+		for (const uint32_t* limit = std::min(list_end + DISTANCE, end_); next_ < limit; ++next_)
+			prefetch_window(window_begin_(*next_), window_);
+	}
+private:
+	const uint32_t* next_, * const end_;
+	const int window_;
+	const _f window_begin_;
+};
 DECL_DISPATCH(void, stage1, (const Packed_loc* q, size_t nq, const Packed_loc* s, size_t ns, Statistics& stats, Trace_pt_buffer::Iterator& out, const unsigned sid, const Context& context))
 
 }
@@ -56,6 +56,25 @@ bool use_single_indexed(double coverage, size_t query_letters, size_t ref_letter
 		return query_letters < 3000000llu && query_letters * 2000llu < ref_letters;
 }
 
+unsigned sensitivity_index_mode(Sensitivity sensitivity)
+{
+	switch (sensitivity) {
+	case Sensitivity::ULTRA_SENSITIVE:
+		return 13;
+	case Sensitivity::VERY_SENSITIVE:
+		return 12;
+	case Sensitivity::MORE_SENSITIVE:
+	case Sensitivity::SENSITIVE:
+		return 9;
+	case Sensitivity::MID_SENSITIVE:
+		return 15;
+	case Sensitivity::FAST:
+		return 16;
+	default:
+		return 8;
+	}
+}
+
 void setup_search()
 {
 	if (config.sensitivity == Sensitivity::ULTRA_SENSITIVE) {
@@ -114,26 +133,7 @@ void setup_search()
 	if(config.algo==Config::query_indexed)
 		config.lowmem = 1;
 	else {
-		switch (config.sensitivity) {
-		case Sensitivity::ULTRA_SENSITIVE:
-			Config::set_option(config.index_mode, 13u);
-			break;
-		case Sensitivity::VERY_SENSITIVE:
-			Config::set_option(config.index_mode, 12u);
-			break;
-		case Sensitivity::MORE_SENSITIVE:
-		case Sensitivity::SENSITIVE:
-			Config::set_option(config.index_mode, 9u);
-			break;
-		case Sensitivity::MID_SENSITIVE:
-			Config::set_option(config.index_mode, 15u);
-			break;
-		case Sensitivity::DEFAULT:
-			Config::set_option(config.index_mode, 8u);
-			break;
-		case Sensitivity::FAST:
-			Config::set_option(config.index_mode, 16u);
-		}
+		Config::set_option(config.index_mode, sensitivity_index_mode(config.sensitivity));
 		Reduction::reduction = Reduction("A KR EDNQ C G H ILVM FYW P ST");
 		::shapes = shape_config(config.index_mode, config.shapes, config.shape_mask);
 	}
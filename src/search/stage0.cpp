@@ -19,19 +19,22 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
-#include <thread>
 #include <utility>
+#include <memory>
 #include <atomic>
 #include "search.h"
 #include "../util/algo/hash_join.h"
 #include "../util/algo/radix_sort.h"
 #include "../data/reference.h"
 #include "../data/seed_array.h"
+#include "../data/seed_index.h"
 #include "../data/queries.h"
 #include "../data/frequent_seeds.h"
 #include "trace_pt_buffer.h"
 #include "../util/data_structures/double_array.h"
 #include "../util/system/system.h"
+#include "../util/parallel/thread_pool.h"
+#include "../util/parallel/node_queue.h"
 
 using std::vector;
 using std::atomic;
@@ -42,15 +45,14 @@ Trace_pt_buffer* Trace_pt_buffer::instance;
 void seed_join_worker(
 	SeedArray *query_seeds,
 	SeedArray *ref_seeds,
-	atomic<unsigned> *seedp,
-	const SeedPartitionRange *seedp_range,
+	Util::Parallel::NodeLocalQueue *seedp,
 	DoubleArray<SeedArray::_pos> *query_seed_hits,
 	DoubleArray<SeedArray::_pos> *ref_seeds_hits)
 {
-	unsigned p;
+	size_t p;
 	const unsigned bits = config.hashed_seeds ? sizeof(SeedArray::Entry::Key) * 8
 		: (unsigned)ceil(shapes[0].weight_ * Reduction::reduction.bit_size_exact()) - Const::seedp_bits;
-	while ((p = (*seedp)++) < seedp_range->end()) {
+	while ((p = seedp->next()) < seedp->end()) {
 		std::pair<DoubleArray<SeedArray::_pos>, DoubleArray<SeedArray::_pos>> join = hash_join(
 			Relation<SeedArray::Entry>(query_seeds->begin(p), query_seeds->size(p)),
 			Relation<SeedArray::Entry>(ref_seeds->begin(p), ref_seeds->size(p)),
@@ -60,25 +62,95 @@ void seed_join_worker(
 	}
 }
 
-void search_worker(atomic<unsigned> *seedp, const SeedPartitionRange *seedp_range, unsigned shape, size_t thread_id, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, const Search::Context *context)
+void search_worker(Util::Parallel::NodeLocalQueue *seedp, unsigned shape, size_t thread_id, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, const Search::Context *context)
 {
 	Trace_pt_buffer::Iterator* out = new Trace_pt_buffer::Iterator(*Trace_pt_buffer::instance, thread_id);
 	Statistics stats;
-	unsigned p;
-	while ((p = (*seedp)++) < seedp_range->end())
+	size_t p;
+	while ((p = seedp->next()) < seedp->end())
 		for (auto it = JoinIterator<SeedArray::_pos>(query_seed_hits[p].begin(), ref_seed_hits[p].begin()); it; ++it)
 			Search::stage1(it.r->begin(), it.r->size(), it.s->begin(), it.s->size(), stats, *out, shape, *context);
 	delete out;
 	statistics += stats;
 }
 
-void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *ref_buffer, const Parameters &params, const Hashed_seed_set* target_seeds)
+struct SeedArrays {
+	SeedArray *query, *ref;
+};
+
+// Reference seed array, restricted to window minimizers in the compact index mode. Must use the same filter as ref_histogram().
+template<typename _filter>
+static SeedArray* ref_seed_array(unsigned sid, const SeedPartitionRange& range, char* ref_buffer, const _filter* filter)
+{
+	if (config.minimizer_window > 0) {
+		const Minimizer_filter<_filter> minimizers(filter, config.minimizer_window);
+		return new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, &minimizers);
+	}
+	return new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, filter);
+}
+
+// Builds the seed arrays of one shape and index chunk. The progress is only reported if timed is set, as the arrays
+// may be built in the background while another shape is searched.
+static SeedArrays build_seed_arrays(unsigned sid, const SeedPartitionRange& range, char* query_buffer, char* ref_buffer, const Hashed_seed_set* target_seeds, const SeedIndex::File* ref_index, bool timed)
+{
+	task_timer timer(timed ? (ref_index ? "Loading reference seed index" : "Building reference seed array") : nullptr, true);
+	SeedArrays a;
+	if (ref_index)
+		a.ref = new SeedArray(*ref_index);
+	else if (config.algo == Config::query_indexed)
+		a.ref = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds);
+	else if (query_seeds_hashed != 0)
+		a.ref = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds_hashed);
+	else if (ref_sketch)
+		a.ref = ref_seed_array(sid, range, ref_buffer, ref_sketch);
+	else
+		a.ref = ref_seed_array(sid, range, ref_buffer, &no_filter);
+
+	timer.go(timed ? "Building query seed array" : nullptr);
+	if (target_seeds)
+		a.query = new SeedArray(*query_seqs::data_, sid, range, target_seeds);
+	else if (query_sketch)
+		a.query = new SeedArray(*query_seqs::data_, sid, query_hst.get(sid), range, query_hst.partition(), query_buffer, query_sketch);
+	else
+		a.query = new SeedArray(*query_seqs::data_, sid, query_hst.get(sid), range, query_hst.partition(), query_buffer, &no_filter);
+	return a;
+}
+
+void search_shapes(unsigned query_block, char *query_buffer, char *ref_buffer, const Parameters &params, const Hashed_seed_set* target_seeds, bool ref_index)
 {
 	::partition<unsigned> p(Const::seedp, config.lowmem);
 	DoubleArray<SeedArray::_pos> query_seed_hits[Const::seedp], ref_seed_hits[Const::seedp];
 	log_rss();
 
-	for (unsigned chunk = 0; chunk < p.parts; ++chunk) {
+	// The index file of a shape is mapped once for all of its index chunks.
+	std::vector<std::unique_ptr<SeedIndex::File>> index_files;
+	if (ref_index) {
+		task_timer timer("Mapping reference seed index");
+		for (unsigned i = 0; i < shapes.count(); ++i)
+			index_files.emplace_back(new SeedIndex::File(SeedIndex::file_name(current_ref_block, i)));
+	}
+
+	// With --overlap-shapes, the seed arrays of the next step (shape and index chunk) are built into a second pair of
+	// buffers by a task of the pool while the current step is searched. The build task is queued ahead of the search
+	// tasks and its parallel parts are picked up by workers as they run out of search work. The frequent seed masking
+	// of a step is complete before the arrays of the next step are built, so the result is the same as in serial order.
+	const unsigned steps = shapes.count() * p.parts;
+	const bool overlap = config.overlap_shapes && steps > 1;
+	// Declared ahead of the build task group of each step, which waits for a pending build if the loop is left by an
+	// exception, so the buffers outlive it.
+	std::unique_ptr<char[]> overlap_query_buffer, overlap_ref_buffer;
+	if (overlap) {
+		task_timer timer("Allocating buffers for overlapped seed arrays");
+		if (query_buffer)
+			overlap_query_buffer.reset(SeedArray::alloc_buffer(query_hst));
+		if (ref_buffer)
+			overlap_ref_buffer.reset(SeedArray::alloc_buffer(ref_hst));
+	}
+	char *buffers[2][2] = { { query_buffer, ref_buffer }, { overlap_query_buffer.get(), overlap_ref_buffer.get() } };
+
+	SeedArrays next;
+	for (unsigned step = 0; step < steps; ++step) {
+		const unsigned sid = step / p.parts, chunk = step % p.parts;
 		message_stream << "Processing query block " << query_block + 1
 			<< ", reference block " << (current_ref_block + 1) << "/" << params.ref_blocks
 			<< ", shape " << (sid + 1) << "/" << shapes.count();
@@ -88,55 +160,52 @@ void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *
 		const SeedPartitionRange range(p.getMin(chunk), p.getMax(chunk));
 		current_range = range;
 
-		task_timer timer("Building reference seed array", true);
-		SeedArray *ref_idx;
-		if (config.algo == Config::query_indexed)
-			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds);
-		else if (query_seeds_hashed != 0)
-			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds_hashed);
-		else
-			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, &no_filter);
-
-		timer.go("Building query seed array");
-		SeedArray* query_idx;
-		if (target_seeds)
-			query_idx = new SeedArray(*query_seqs::data_, sid, range, target_seeds);
-		else
-			query_idx = new SeedArray(*query_seqs::data_, sid, query_hst.get(sid), range, query_hst.partition(), query_buffer, &no_filter);
-		timer.finish();
-
-		log_stream << "Indexed query seeds = " << query_idx->size() << '/' << query_seqs::get().letters() << ", reference seeds = " << ref_idx->size() << '/' << ref_seqs::get().letters() << endl;
-
-		timer.go("Computing hash join");
-		atomic<unsigned> seedp(range.begin());
-		vector<std::thread> threads;
-		for (size_t i = 0; i < config.threads_; ++i)
-			threads.emplace_back(seed_join_worker, query_idx, ref_idx, &seedp, &range, query_seed_hits, ref_seed_hits);
-		for (auto &t : threads)
-			t.join();
+		const SeedArrays arrays = overlap && step > 0 ? next
+			: build_seed_arrays(sid, range, buffers[0][0], buffers[0][1], target_seeds, ref_index ? index_files[sid].get() : nullptr, true);
+
+		log_stream << "Indexed query seeds = " << arrays.query->size() << '/' << query_seqs::get().letters() << ", reference seeds = " << arrays.ref->size() << '/' << ref_seqs::get().letters() << endl;
+
+		task_timer timer("Computing hash join");
+		// In NUMA mode, the seed partitions are processed by workers of the node that holds their seed array entries,
+		// so that the join output is allocated in local memory as well.
+		Util::Parallel::NodeLocalQueue join_queue(range.begin(), range.end());
+		Util::Parallel::run_tasks(config.threads_, [&](size_t) {
+			seed_join_worker(arrays.query, arrays.ref, &join_queue, query_seed_hits, ref_seed_hits);
+		});
 
 		timer.go("Building seed filter");
 		frequent_seeds.build(sid, range, query_seed_hits, ref_seed_hits);
 
-		Search::Context* context = nullptr;
+		Util::Parallel::TaskGroup build;
+		if (overlap && step + 1 < steps) {
+			const unsigned next_sid = (step + 1) / p.parts, next_chunk = (step + 1) % p.parts;
+			char **next_buffers = buffers[(step + 1) % 2];
+			const SeedIndex::File* next_index = ref_index ? index_files[next_sid].get() : nullptr;
+			build.run([&next, next_sid, next_chunk, next_buffers, &p, target_seeds, next_index]() {
+				next = build_seed_arrays(next_sid, SeedPartitionRange(p.getMin(next_chunk), p.getMax(next_chunk)), next_buffers[0], next_buffers[1], target_seeds, next_index, false);
+			});
+		}
+
 		const vector<uint32_t> patterns = shapes.patterns(0, sid + 1);
-		context = new Search::Context{ {patterns.data(), patterns.data() + patterns.size() - 1 },
+		const Search::Context context{ {patterns.data(), patterns.data() + patterns.size() - 1 },
 			{patterns.data(), patterns.data() + patterns.size() },
 			config.ungapped_evalue,
 			config.ungapped_evalue_short,
-			score_matrix.rawscore(config.short_query_ungapped_bitscore)
+			score_matrix.rawscore(config.short_query_ungapped_bitscore),
+			p.parts > 1
 		};
 
 		timer.go("Searching alignments");
-		seedp = range.begin();
-		threads.clear();
-		for (size_t i = 0; i < config.threads_; ++i)
-			threads.emplace_back(search_worker, &seedp, &range, sid, i, query_seed_hits, ref_seed_hits, context);
-		for (auto &t : threads)
-			t.join();
-
-		delete ref_idx;
-		delete query_idx;
-		delete context;
+		Util::Parallel::NodeLocalQueue search_queue(range.begin(), range.end());
+		Util::Parallel::run_tasks(config.threads_, [&](size_t i) {
+			search_worker(&search_queue, sid, i, query_seed_hits, ref_seed_hits, &context);
+		});
+		delete arrays.ref;
+		delete arrays.query;
+
+		// The next step builds into the buffers searched by this one, so the build has to be complete before the loop
+		// moves on.
+		timer.go("Waiting for the next seed arrays");
+		build.wait();
 	}
-}
\ No newline at end of file
+}
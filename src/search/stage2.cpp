@@ -62,6 +62,22 @@ static int ungapped_window(int query_len) {
 		return config.ungapped_window;
 }
 
+void window_ungapped_batches(const Letter* query, const Letter** subjects, size_t subject_count, int window, int* out, bool prefetch) {
+	constexpr size_t N = ::DISPATCH_ARCH::SIMD::Vector<int8_t>::CHANNELS;
+	// The subject windows are scattered over the reference block, so the windows of the next batch are
+	// prefetched while the current batch is scored.
+	if (prefetch)
+		for (size_t j = 0; j < std::min(N, subject_count); ++j)
+			prefetch_window(subjects[j], window);
+	for (size_t i = 0; i < subject_count; i += N) {
+		const size_t n = std::min(N, subject_count - i);
+		if (prefetch)
+			for (size_t j = i + N; j < std::min(i + 2 * N, subject_count); ++j)
+				prefetch_window(subjects[j], window);
+		DP::window_ungapped_best(query, subjects + i, (int)n, window, out + i);
+	}
+}
+
 void search_query_offset(uint64_t q,
 	const Packed_loc* s,
 	const uint32_t *hits,
@@ -69,18 +85,17 @@ void search_query_offset(uint64_t q,
 	Statistics& stats,
 	Trace_pt_buffer::Iterator& out,
 	const unsigned sid,
-	const Context& context)
+	const Context& context,
+	bool prefetch)
 {
 	thread_local TextBuffer output_buf;
+	thread_local vector<std::pair<Packed_loc, uint16_t>> delta_buf;
+	thread_local vector<const Letter*> subjects;
+	thread_local vector<int> scores;
 
-	constexpr auto N = vector<Stage1_hit>::const_iterator::difference_type(::DISPATCH_ARCH::SIMD::Vector<int8_t>::CHANNELS);
 	const bool long_subject_offsets = ::long_subject_offsets();
 	const Letter* query = query_seqs::data_->data(q);
 
-	const Letter* subjects[N];
-	int scores[N];
-	std::fill(scores, scores + N, INT_MAX);
-
 	unsigned query_id = UINT_MAX, seed_offset = UINT_MAX;
 	std::pair<size_t, size_t> l = query_seqs::data_->local_position(q);
 	query_id = (unsigned)l.first;
@@ -94,41 +109,48 @@ void search_query_offset(uint64_t q,
 
 	const int interval_mod = config.left_most_interval > 0 ? seed_offset % config.left_most_interval : window_left, interval_overhang = std::max(window_left - interval_mod, 0);
 
-	for (const uint32_t *i = hits; i < hits_end; i += N) {
+	const size_t n = hits_end - hits;
+	subjects.clear();
+	for (const uint32_t* i = hits; i < hits_end; ++i)
+		subjects.push_back(ref_seqs::data_->data(s[*i]) - window_left);
+	scores.resize(n);
+	window_ungapped_batches(query_clipped.data(), subjects.data(), n, window_clipped, scores.data(), prefetch);
 
-		const size_t n = std::min(N, hits_end - i);
-		for (size_t j = 0; j < n; ++j)
-			subjects[j] = ref_seqs::data_->data(s[*(i + j)]) - window_left;
-		DP::window_ungapped_best(query_clipped.data(), subjects, n, window_clipped, scores);
-
-		for (size_t j = 0; j < n; ++j) {
-			if (scores[j] > score_cutoff) {
+	for (size_t j = 0; j < n; ++j) {
+		if (scores[j] > score_cutoff) {
 #ifdef UNGAPPED_SPOUGE
-				std::pair<size_t, size_t> l = ref_seqs::data_->local_position(s[*(i + j)]);
-				if (scores[j] < context.cutoff_table(query_len, ref_seqs::data_->length(l.first)))
-					continue;
+			std::pair<size_t, size_t> l = ref_seqs::data_->local_position(s[hits[j]]);
+			if (scores[j] < context.cutoff_table(query_len, ref_seqs::data_->length(l.first)))
+				continue;
 #endif
-				stats.inc(Statistics::TENTATIVE_MATCHES2);
-				if (left_most_filter(query_clipped + interval_overhang, subjects[j] + interval_overhang, window_left - interval_overhang, shapes[sid].length_, context, sid == 0, sid, score_cutoff)) {
-					stats.inc(Statistics::TENTATIVE_MATCHES3);
-					if (hit_count == 0) {
-						output_buf.clear();
-						output_buf.write_varint(query_id);
-						output_buf.write_varint(seed_offset);
-					}
+			stats.inc(Statistics::TENTATIVE_MATCHES2);
+			// The left-most check assumes that all seed positions are indexed, which does not hold for the minimizer index.
+			if (config.minimizer_window > 0 || left_most_filter(query_clipped + interval_overhang, subjects[j] + interval_overhang, window_left - interval_overhang, shapes[sid].length_, context, sid == 0, sid, score_cutoff)) {
+				stats.inc(Statistics::TENTATIVE_MATCHES3);
+				if (hit_count == 0) {
+					output_buf.clear();
+					output_buf.write_varint(query_id);
+					output_buf.write_varint(seed_offset);
+					delta_buf.clear();
+				}
+				if (config.compress_temp)
+					delta_buf.emplace_back(s[hits[j]], (uint16_t)scores[j]);
+				else {
 					if (long_subject_offsets)
-						output_buf.write_raw((const char*)&s[*(i + j)], 5);
+						output_buf.write_raw((const char*)&s[hits[j]], 5);
 					else
-						output_buf.write(s[*(i + j)].low);
+						output_buf.write(s[hits[j]].low);
 					output_buf.write((uint16_t)scores[j]);
-					++hit_count;
 				}
+				++hit_count;
 			}
 		}
 	}
 
 	if (hit_count > 0) {
-		if (long_subject_offsets)
+		if (config.compress_temp)
+			hit::write_deltas(output_buf, delta_buf.data(), delta_buf.data() + delta_buf.size());
+		else if (long_subject_offsets)
 			output_buf.write(packed_uint40_t(0));
 		else
 			output_buf.write((uint32_t)0);
@@ -150,12 +172,20 @@ struct Stage2 {
 	void operator()(const FlatArray<uint32_t> &hits, uint32_t query_begin, uint32_t subject_begin) {
 		stat.inc(Statistics::TENTATIVE_MATCHES1, hits.data_size());
 		const uint32_t query_count = (uint32_t)hits.size();
+		if (hits.data_size() == 0)
+			return;
 		const Packed_loc* q_begin = q + query_begin, * s_begin = s + subject_begin;
+		// The subject windows of the hits are prefetched ahead of scoring over the whole hit range of the tile.
+		// Hit lists longer than the prefetch distance additionally prefetch batch by batch.
+		const int window = config.ungapped_window;
+		auto window_begin = [s_begin, window](uint32_t hit) { return ref_seqs::data_->data(s_begin[hit]) - window; };
+		WindowPrefetcher<decltype(window_begin)> prefetcher(hits.begin(0), hits.begin(0) + hits.data_size(), 2 * window, window_begin);
 		for (uint32_t i = 0; i < query_count; ++i) {
 			const uint32_t* r1 = hits.begin(i), * r2 = hits.end(i);
 			if (r2 == r1)
 				continue;
-			search_query_offset(q_begin[i], s_begin, r1, r2, stat, out, sid, context);
+			prefetcher.advance(r2);
+			search_query_offset(q_begin[i], s_begin, r1, r2, stat, out, sid, context, r2 - r1 > decltype(prefetcher)::DISTANCE);
 		}
 	}
 
@@ -167,7 +197,7 @@ struct Stage2 {
 
 };
 
-typedef vector<Finger_print, Util::Memory::AlignmentAllocator<Finger_print, 16>> Container;
+typedef vector<Finger_print, Util::Memory::AlignmentAllocator<Finger_print, FINGER_PRINT_ALIGN>> Container;
 
 static void load_fps(const Packed_loc* p, size_t n, Container& v, const Sequence_set& seqs)
 {
@@ -22,10 +22,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include <stdint.h>
+#include <algorithm>
 #include "../util/async_buffer.h"
 #include "../basic/match.h"
 #include "../util/io/deserializer.h"
 #include "../data/reference.h"
+#include "../util/text_buffer.h"
 
 #pragma pack(1)
 
@@ -107,6 +109,7 @@ struct hit
 		const uint64_t x = (uint64_t)lhs.subject_ + (uint64_t)rhs.seed_offset_, y = (uint64_t)rhs.subject_ + (uint64_t)lhs.seed_offset_;
 		return x < y || (x == y && lhs.seed_offset_ < rhs.seed_offset_);
 	}
+	enum : uint32_t { DELTA_ESCAPE = UINT32_MAX };
 	static bool cmp_frame(const hit &x, const hit &y) {
 		return x.frame() < y.frame();
 	}
@@ -115,12 +118,56 @@ struct hit
 		s << me.query_ << '\t' << uint64_t(me.subject_) << '\t' << me.seed_offset_ << '\n';
 		return s;
 	}
+	// Writes the subject locations and scores of one query offset in ascending order of
+	// subject, each location encoded as a varint delta to the previous one (--compress-temp).
+	// Deltas that do not fit into 32 bits are escaped and followed by the raw 40 bit delta.
+	static void write_deltas(TextBuffer& buf, std::pair<Packed_loc, uint16_t>* begin, std::pair<Packed_loc, uint16_t>* end) {
+		std::sort(begin, end);
+		uint64_t last = 0;
+		for (auto i = begin; i < end; ++i) {
+			const uint64_t delta = uint64_t(i->first) - last;
+			if (delta < DELTA_ESCAPE)
+				buf.write_varint((uint32_t)delta);
+			else {
+				buf.write_varint(DELTA_ESCAPE);
+				buf.write(packed_uint40_t(delta));
+			}
+			buf.write_varint(i->second);
+			last = i->first;
+		}
+		buf.write_varint(0);
+	}
+	template<typename _it>
+	static size_t read_deltas(Deserializer& s, _it it, uint32_t query_id, uint32_t seed_offset) {
+		uint64_t last = 0;
+		uint32_t delta, score;
+		packed_uint40_t long_delta;
+		size_t count = 0;
+		for (;;) {
+			s >> delta;
+			if (delta == 0)
+				return count;
+			if (delta == DELTA_ESCAPE) {
+				s.varint = false;
+				s.read(long_delta);
+				s.varint = true;
+				last += uint64_t(long_delta);
+			}
+			else
+				last += delta;
+			s >> score;
+			*it = { query_id, Packed_loc(last), seed_offset, (uint16_t)score };
+			++count;
+		}
+	}
 	template<typename _it>
 	static size_t read(Deserializer& s, _it it) {
 		const bool l = long_subject_offsets();
 		uint32_t query_id, seed_offset;
 		s.varint = true;
 		s >> query_id >> seed_offset;
+		if (config.compress_temp)
+			return read_deltas(s, it, query_id, seed_offset);
 		Packed_loc subject_loc;
 		size_t count = 0;
 		uint32_t x;
@@ -150,7 +197,7 @@ struct hit
 struct Trace_pt_buffer : public Async_buffer<hit>
 {
 	Trace_pt_buffer(size_t input_size, const string &tmpdir, unsigned query_bins):
-		Async_buffer<hit>(input_size, tmpdir, query_bins)
+		Async_buffer<hit>(input_size, tmpdir, query_bins, size_t(config.trace_pt_membuf * 1e9), config.compress_temp == 2)
 	{}
 	static Trace_pt_buffer *instance;
 };
@@ -101,10 +101,6 @@ TargetMatrix::TargetMatrix(const Composition& query_comp, int query_len, const s
             return;
     }
 
-    scores.resize(32 * AMINO_ACID_COUNT);
-    scores32.resize(32 * AMINO_ACID_COUNT);
-    score_min = INT_MAX;
-    score_max = INT_MIN;
     vector<int> s;
     
     if (config.comp_based_stats == CBS::COMP_BASED_STATS || rule == eCompoScaleOldMatrix)
@@ -112,6 +108,20 @@ TargetMatrix::TargetMatrix(const Composition& query_comp, int query_len, const s
     else
         s = CompositionMatrixAdjust(query_len, count_true_aa(target), query_comp.data(), c.data(), config.cbs_matrix_scale, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs());
     
+    init(s.data());
+}
+
+TargetMatrix::TargetMatrix(const int* adjusted_scores)
+{
+    init(adjusted_scores);
+}
+
+void TargetMatrix::init(const int* s)
+{
+    scores.resize(32 * AMINO_ACID_COUNT);
+    scores32.resize(32 * AMINO_ACID_COUNT);
+    score_min = INT_MAX;
+    score_max = INT_MIN;
     for (size_t i = 0; i < AMINO_ACID_COUNT; ++i) {
         for (size_t j = 0; j < AMINO_ACID_COUNT; ++j)
             if ((i < 20 || i == MASK_LETTER) && (j < 20 || j == MASK_LETTER)) {
@@ -131,6 +141,45 @@ TargetMatrix::TargetMatrix(const Composition& query_comp, int query_len, const s
     }
 }
 
+vector<TargetMatrix> TargetMatrices(const Composition& query_comp, int query_len, const sequence* targets, size_t n)
+{
+    vector<TargetMatrix> out(n);
+    if (!CBS::matrix_adjust(config.comp_based_stats))
+        return out;
+
+    // Targets that need the full adjustment are collected and solved together, the others are handled as in the
+    // single target constructor.
+    vector<size_t> adjust;
+    vector<int> target_len;
+    vector<Composition> target_comp;
+    for (size_t i = 0; i < n; ++i) {
+        vector<Letter> target_seq = targets[i].copy();
+        auto c = composition(sequence(target_seq.data(), target_seq.size()));
+        EMatrixAdjustRule rule = eUserSpecifiedRelEntropy;
+        if (CBS::conditioned(config.comp_based_stats)) {
+            rule = s_TestToApplyREAdjustmentConditional(query_len, (int)targets[i].length(), query_comp.data(), c.data(), score_matrix.background_freqs());
+            if (rule == eCompoScaleOldMatrix && config.comp_based_stats != CBS::COMP_BASED_STATS_AND_MATRIX_ADJUST)
+                continue;
+        }
+        if (config.comp_based_stats == CBS::COMP_BASED_STATS || rule == eCompoScaleOldMatrix) {
+            const vector<int> s = CompositionBasedStats(score_matrix.matrix32_scaled_pointers().data(), query_comp, c, score_matrix.ungapped_lambda(), score_matrix.freq_ratios());
+            out[i] = TargetMatrix(s.data());
+        }
+        else {
+            adjust.push_back(i);
+            target_len.push_back(count_true_aa(targets[i]));
+            target_comp.push_back(c);
+        }
+    }
+
+    if (adjust.empty())
+        return out;
+    const vector<int> s = CompositionMatrixAdjust(query_len, query_comp.data(), adjust.size(), target_len.data(), target_comp.data(), config.cbs_matrix_scale, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs());
+    for (size_t i = 0; i < adjust.size(); ++i)
+        out[adjust[i]] = TargetMatrix(&s[i * AMINO_ACID_COUNT * AMINO_ACID_COUNT]);
+    return out;
+}
+
 TargetMatrix::TargetMatrix(const int16_t* query_matrix, const int16_t* target_matrix) :
     scores(32 * AMINO_ACID_COUNT),
     scores32(32 * AMINO_ACID_COUNT),
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <array>
 #include <vector>
 #include "../basic/sequence.h"
+#include "../util/simd.h"
 #include "standard_matrix.h"
 
 namespace Stats {
@@ -40,11 +41,18 @@ struct TargetMatrix {
 
     TargetMatrix(const Composition& query_comp, int query_len, const sequence& target);
 
+    // Initializes from an AMINO_ACID_COUNT * AMINO_ACID_COUNT matrix of adjusted scores.
+    TargetMatrix(const int* adjusted_scores);
+
     std::vector<int8_t> scores;
     std::vector<int32_t> scores32;
 
     int score_min, score_max;
 
+private:
+
+    void init(const int* adjusted_scores);
+
 };
 
 /** An collection of constants that specify all rules that may
@@ -201,6 +209,9 @@ struct CBS {
 };
 
 std::vector<int> CompositionMatrixAdjust(int query_len, int target_len, const double* query_comp, const double* target_comp, int scale, double ungapped_lambda, const double* joint_probs, const double* background_freqs);
+// Adjusts the matrix for n target compositions against the same query composition and returns the concatenated
+// matrices. The targets are solved in order, each starting from the solution of the previous one.
+std::vector<int> CompositionMatrixAdjust(int query_len, const double* query_comp, size_t n, const int* target_len, const Composition* target_comp, int scale, double ungapped_lambda, const double* joint_probs, const double* background_freqs);
 std::vector<int> CompositionBasedStats(const int* const* matrix_in, const Composition& queryProb, const Composition& resProb, double lambda, const FreqRatios& freq_ratios);
 int Blast_OptimizeTargetFrequencies(double x[],
     int alphsize,
@@ -212,7 +223,8 @@ int Blast_OptimizeTargetFrequencies(double x[],
     double relative_entropy,
     double tol,
     int maxits);
-bool OptimizeTargetFrequencies(double* out, const double* joints_prob, const double* row_probs, const double* col_probs, double relative_entropy, double tol, int maxits);
+DECL_DISPATCH(bool, OptimizeTargetFrequencies, (double* out, const double* joints_prob, const double* row_probs, const double* col_probs, double relative_entropy, double tol, int maxits))
+DECL_DISPATCH(void, OptimizeTargetFrequenciesBatch, (double* out, bool* converged, size_t n, const double* joints_prob, const double* row_probs, const double* col_probs, double relative_entropy, double tol, int maxits))
 
 inline int16_t* make_16bit_matrix(const std::vector<int>& matrix) {
     int16_t* out = new int16_t[TRUE_AA * TRUE_AA];
@@ -222,6 +234,9 @@ inline int16_t* make_16bit_matrix(const std::vector<int>& matrix) {
     return out;
 }
 
+// Same as constructing TargetMatrix for each of the n targets, with the full matrix adjustments solved as a batch.
+std::vector<TargetMatrix> TargetMatrices(const Composition& query_comp, int query_len, const sequence* targets, size_t n);
+
 extern const int ALPH_TO_NCBI[];
 extern CBS comp_based_stats;
 
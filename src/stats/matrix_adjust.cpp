@@ -110,6 +110,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
+#include <memory>
 #include "../lib/blast/nlm_linear_algebra.h"
 #include "cbs.h"
 
@@ -1294,4 +1295,31 @@ vector<int> CompositionMatrixAdjust(int query_len, int target_len, const double*
     return v;
 }
 
+vector<int> CompositionMatrixAdjust(int query_len, const double* query_comp, size_t n, const int* target_len, const Composition* target_comp, int scale, double ungapped_lambda, const double* joint_probs, const double* background_freqs) {
+    double row_probs[TRUE_AA];
+    vector<double> col_probs(n * TRUE_AA), mat_final(n * TRUE_AA * TRUE_AA);
+    std::unique_ptr<bool[]> converged(new bool[n]);
+    std::copy(query_comp, query_comp + TRUE_AA, row_probs);
+    Blast_ApplyPseudocounts(row_probs, query_len, background_freqs);
+    for (size_t i = 0; i < n; ++i) {
+        std::copy(target_comp[i].begin(), target_comp[i].end(), col_probs.begin() + i * TRUE_AA);
+        Blast_ApplyPseudocounts(&col_probs[i * TRUE_AA], target_len[i], background_freqs);
+    }
+
+    OptimizeTargetFrequenciesBatch(mat_final.data(), converged.get(), n, joint_probs, row_probs, col_probs.data(), kFixedReBlosum62, config.cbs_err_tolerance, config.cbs_it_limit);
+
+    vector<int> v(n * AMINO_ACID_COUNT * AMINO_ACID_COUNT);
+    vector<int*> p(AMINO_ACID_COUNT);
+    for (size_t k = 0; k < n; ++k) {
+        int* m = &v[k * AMINO_ACID_COUNT * AMINO_ACID_COUNT];
+        for (size_t i = 0; i < AMINO_ACID_COUNT; ++i)
+            p[i] = m + i * AMINO_ACID_COUNT;
+        if (!converged[k] || s_ScoresStdAlphabet(p.data(), AMINO_ACID_COUNT, &mat_final[k * TRUE_AA * TRUE_AA], row_probs, &col_probs[k * TRUE_AA], ungapped_lambda / scale) != 0)
+            for (size_t i = 0; i < AMINO_ACID_COUNT; ++i)
+                for (size_t j = 0; j < AMINO_ACID_COUNT; ++j)
+                    m[i * AMINO_ACID_COUNT + j] = score_matrix(i, j) * scale;
+    }
+    return v;
+}
+
 }
\ No newline at end of file
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/Eigen/Dense"
 #include "../basic/value.h"
 #include "../util/profiler.h"
+#include "cbs.h"
 
 // #define DYNAMIC
 
@@ -33,26 +34,28 @@ using std::endl;
 //#define DEBUG_OUT(x) cout << (x) << endl
 #define DEBUG_OUT(x)
 
+namespace Stats { namespace DISPATCH_ARCH {
+
 static const size_t N = TRUE_AA;
-typedef float Float;
+typedef double Float;
 const auto StorageOrder = RowMajor;
 #ifdef DYNAMIC
-typedef Matrix<Float, Dynamic, Dynamic, StorageOrder> MatrixN;
-typedef Matrix<Float, Dynamic, Dynamic, StorageOrder> Matrix2Nx;
-typedef Matrix<Float, Dynamic, 1> VectorN;
-typedef Matrix<Float, Dynamic, 1> Vector2N;
-typedef Matrix<Float, Dynamic, 1> Vector2Nx;
-typedef Matrix<Float, 1, Dynamic> VectorNN;
-typedef Matrix<Float, 2, Dynamic, StorageOrder> Vector2NN;
+typedef Eigen::Matrix<Float, Dynamic, Dynamic, StorageOrder> MatrixN;
+typedef Eigen::Matrix<Float, Dynamic, Dynamic, StorageOrder> Matrix2Nx;
+typedef Eigen::Matrix<Float, Dynamic, 1> VectorN;
+typedef Eigen::Matrix<Float, Dynamic, 1> Vector2N;
+typedef Eigen::Matrix<Float, Dynamic, 1> Vector2Nx;
+typedef Eigen::Matrix<Float, 1, Dynamic> VectorNN;
+typedef Eigen::Matrix<Float, 2, Dynamic, StorageOrder> Vector2NN;
 typedef decltype(Vector2Nx().head(Index())) Block2N;
 #else
-typedef Matrix<Float, N, N, StorageOrder> MatrixN;
-typedef Matrix<Float, 2 * N, 2 * N, StorageOrder> Matrix2Nx;
-typedef Matrix<Float, N, 1> VectorN;
-typedef Matrix<Float, 2 * N - 1, 1> Vector2N;
-typedef Matrix<Float, 2 * N, 1> Vector2Nx;
-typedef Matrix<Float, 1, N* N> VectorNN;
-typedef Matrix<Float, 2, N * N, StorageOrder> Vector2NN;
+typedef Eigen::Matrix<Float, N, N, StorageOrder> MatrixN;
+typedef Eigen::Matrix<Float, 2 * N, 2 * N, StorageOrder> Matrix2Nx;
+typedef Eigen::Matrix<Float, N, 1> VectorN;
+typedef Eigen::Matrix<Float, 2 * N - 1, 1> Vector2N;
+typedef Eigen::Matrix<Float, 2 * N, 1> Vector2Nx;
+typedef Eigen::Matrix<Float, 1, N* N> VectorNN;
+typedef Eigen::Matrix<Float, 2, N * N, StorageOrder> Vector2NN;
 typedef decltype(Vector2Nx().head<2 * N - 1>()) Block2N;
 #endif
 using Values = Float[2];
@@ -350,7 +353,10 @@ static Float Nlm_StepBound(const MatrixN& x, const MatrixN& step_x, Float max)
     return alpha;
 }
 
+// Starts from x and z if warm_start is set, otherwise from x = q and z = 0.
 static bool Blast_OptimizeTargetFrequencies(MatrixN& x,
+    Vector2Nx& z,
+    bool warm_start,
     const MatrixN& q,
     const VectorN& row_sums,
     const VectorN& col_sums,
@@ -363,8 +369,6 @@ static bool Blast_OptimizeTargetFrequencies(MatrixN& x,
     Values values;   /* values of the nonlinear functions at this iterate */
     Vector2NN grads(2,N*N);     /* gradients of the nonlinear functions at this iterate */
     ReNewtonSystem newton_system;   /* factored matrix of the linear system to be solved at this iteration */
-    Vector2Nx z(2*N);     /* dual variables (Lagrange multipliers) */
-    z.fill(0.0);
     MatrixN resids_x(N,N);   /* dual residuals (gradient of Lagrangian) */
     Vector2Nx resids_z(2*N);   /* primal (constraint) residuals */
     Float rnorm;               /* norm of the residuals for the current iterate */
@@ -374,8 +378,6 @@ static bool Blast_OptimizeTargetFrequencies(MatrixN& x,
     Values values;   /* values of the nonlinear functions at this iterate */
     Vector2NN grads;     /* gradients of the nonlinear functions at this iterate */
     ReNewtonSystem newton_system;   /* factored matrix of the linear system to be solved at this iteration */
-    Vector2Nx z;     /* dual variables (Lagrange multipliers) */
-    z.fill(0.0);
     MatrixN resids_x;   /* dual residuals (gradient of Lagrangian) */
     Vector2Nx resids_z;   /* primal (constraint) residuals */
     Float rnorm;               /* norm of the residuals for the current iterate */
@@ -387,7 +389,10 @@ static bool Blast_OptimizeTargetFrequencies(MatrixN& x,
     DEBUG_OUT(old_scores);
 
     /* Use q as the initial value for x */
-    x = q;
+    if (!warm_start) {
+        x = q;
+        z.fill(0.0);
+    }
     int its = 0;        /* Initialize the iteration count. Note that we may converge in zero iterations if the initial x is optimal. */
     while (its <= maxits) {
         /* Compute the residuals */
@@ -421,11 +426,9 @@ static bool Blast_OptimizeTargetFrequencies(MatrixN& x,
 
     }
     DEBUG_OUT(x);
-    return its <= maxits && rnorm <= tol && z[2*N] < 1.0;
+    return its <= maxits && rnorm <= tol && z[2 * N - 1] < 1.0;
 }
 
-namespace Stats {
-
 bool OptimizeTargetFrequencies(double* out, const double* joints_prob, const double* row_probs, const double* col_probs, double relative_entropy, double tol, int maxits) {
 #ifdef DYNAMIC
     MatrixN x(N,N) , q(N,N);
@@ -440,11 +443,47 @@ bool OptimizeTargetFrequencies(double* out, const double* joints_prob, const dou
         row_sums[i] = row_probs[i];
         col_sums[i] = col_probs[i];
     }
-    bool r = Blast_OptimizeTargetFrequencies(x, q, row_sums, col_sums, relative_entropy, tol, maxits);
+#ifdef DYNAMIC
+    Vector2Nx z(2 * N);
+#else
+    Vector2Nx z;
+#endif
+    bool r = Blast_OptimizeTargetFrequencies(x, z, false, q, row_sums, col_sums, relative_entropy, tol, maxits);
     for (size_t i = 0; i < N; ++i)
         for (size_t j = 0; j < N; ++j)
             out[i * N + j] = x(i, j);
     return r;
 }
 
-}
\ No newline at end of file
+void OptimizeTargetFrequenciesBatch(double* out, bool* converged, size_t n, const double* joints_prob, const double* row_probs, const double* col_probs, double relative_entropy, double tol, int maxits) {
+#ifdef DYNAMIC
+    MatrixN x(N, N), q(N, N);
+    VectorN row_sums(N), col_sums(N);
+    Vector2Nx z(2 * N);
+#else
+    MatrixN x, q;
+    VectorN row_sums, col_sums;
+    Vector2Nx z;
+#endif
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t j = 0; j < N; ++j)
+            q(i, j) = joints_prob[i * N + j];
+        row_sums[i] = row_probs[i];
+    }
+    bool warm_start = false;
+    for (size_t k = 0; k < n; ++k) {
+        for (size_t i = 0; i < N; ++i)
+            col_sums[i] = col_probs[k * N + i];
+        // The solution for the previous target is a close starting point if the compositions are similar. If the
+        // iteration fails from there, the target is solved again from the default starting point.
+        converged[k] = Blast_OptimizeTargetFrequencies(x, z, warm_start, q, row_sums, col_sums, relative_entropy, tol, maxits);
+        if (!converged[k] && warm_start)
+            converged[k] = Blast_OptimizeTargetFrequencies(x, z, false, q, row_sums, col_sums, relative_entropy, tol, maxits);
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < N; ++j)
+                out[k * N * N + i * N + j] = x(i, j);
+        warm_start = converged[k];
+    }
+}
+
+}}
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <algorithm>
 #include <iomanip>
 #include <list>
+#include <stdio.h>
 #include "../util/io/temp_file.h"
 #include "../util/io/text_input_file.h"
 #include "test.h"
@@ -37,6 +38,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/util.h"
 #include "../util/string/string.h"
 #include "../util/system/system.h"
+#include "../stats/cbs.h"
+#include "../stats/score_matrix.h"
+#include "../data/seed_index.h"
+#include "../basic/shape_config.h"
 
 using std::endl;
 using std::string;
@@ -46,27 +51,110 @@ using std::list;
 
 namespace Test {
 
-size_t run_testcase(size_t i, DatabaseFile &db, list<TextInputFile> &query_file, size_t max_width, bool bootstrap, bool log, bool to_cout) {
-	vector<string> args = tokenize(test_cases[i].command_line, " ");
+static void print_result(const char* desc, bool passed, size_t max_width) {
+	cout << std::setw(max_width) << std::left << desc << " [ ";
+	set_color(passed ? Color::GREEN : Color::RED);
+	cout << (passed ? "Passed" : "Failed");
+	reset_color();
+	cout << " ]" << endl;
+}
+
+// Checks that the batched composition matrix adjustment computes the same matrices as adjusting the targets one by one.
+static size_t test_cbs_batch(size_t max_width) {
+	score_matrix = Score_matrix("BLOSUM62", config.gap_open, config.gap_extend, config.frame_shift, 1);
+	const vector<Letter> query = sequence::from_string(seqs.front().second.c_str());
+	const Stats::Composition query_comp = Stats::composition(sequence(query));
+	const int query_len = Stats::count_true_aa(sequence(query));
+	vector<Stats::Composition> target_comp;
+	vector<int> target_len, single;
+	for (auto i = seqs.begin() + 1; i != seqs.end(); ++i) {
+		const vector<Letter> target = sequence::from_string(i->second.c_str());
+		target_comp.push_back(Stats::composition(sequence(target)));
+		target_len.push_back(Stats::count_true_aa(sequence(target)));
+		const vector<int> m = Stats::CompositionMatrixAdjust(query_len, target_len.back(), query_comp.data(), target_comp.back().data(), config.cbs_matrix_scale, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs());
+		single.insert(single.end(), m.begin(), m.end());
+	}
+	const vector<int> batch = Stats::CompositionMatrixAdjust(query_len, query_comp.data(), target_comp.size(), target_len.data(), target_comp.data(), config.cbs_matrix_scale, score_matrix.ideal_lambda(), score_matrix.joint_probs(), score_matrix.background_freqs());
+	const bool passed = batch == single;
+	print_result("cbs-batch matrices", passed, max_width);
+	return passed ? 1 : 0;
+}
+
+static void set_config(const string& command_line, bool log) {
+	vector<string> args = tokenize(command_line.c_str(), " ");
 	args.emplace(args.begin(), "diamond");
 	if (log)
 		args.push_back("--log");
 	config = Config((int)args.size(), charp_array(args.begin(), args.end()).data(), false);
+}
+
+static void search(const string& command_line, DatabaseFile& db, list<TextInputFile>& query_file, bool log, Consumer* consumer) {
+	set_config(command_line, log);
 	statistics.reset();
 	Workflow::Search::Options opt;
 	opt.db = &db;
 	query_file.front().rewind();
 	opt.query_file = &query_file;
+	opt.consumer = consumer;
+	Workflow::Search::run(opt);
+}
+
+static uint64_t search_hash(const string& command_line, DatabaseFile& db, list<TextInputFile>& query_file, bool log) {
+	TempFile output_file;
+	search(command_line, db, query_file, log, &output_file);
+	InputFile out_in(output_file);
+	const uint64_t hash = out_in.hash();
+	out_in.close_and_delete();
+	return hash;
+}
+
+// Builds a seed index for the test database and checks that searching with it gives the same output as without it.
+static size_t test_seed_index(DatabaseFile& db, list<TextInputFile>& query_file, size_t max_width, bool log) {
+	const string command_line = "blastp -p4 --algo 0";
+	const uint64_t expected = search_hash(command_line, db, query_file, log);
+
+	string db_name;
+	{
+		TempFile t;
+		InputFile f(t);
+		f.close_and_delete();
+		db_name = f.file_name;
+	}
+	set_config("makeidx -d " + db_name, log);
+	make_seed_index(db);
+	const bool built = exists(SeedIndex::file_name(0, 0));
+	const uint64_t hash = search_hash(command_line + " -d " + db_name, db, query_file, log);
+
+	for (size_t block = 0; exists(SeedIndex::file_name(block, 0)); ++block)
+		for (unsigned shape = 0; shape < shapes.count(); ++shape)
+			remove(SeedIndex::file_name(block, shape).c_str());
+
+	const bool passed = built && hash == expected;
+	print_result("seed index", passed, max_width);
+	return passed ? 1 : 0;
+}
 
+// Checks that the seed sketch drops frequent seeds when its cap is low enough to be reached by the test dataset, which
+// reduces the seed hits while the search still reports alignments.
+static size_t test_seed_sketch(DatabaseFile& db, list<TextInputFile>& query_file, size_t max_width, bool log) {
+	const string command_line = "blastp --more-sensitive -c1 -p4";
+	search_hash(command_line, db, query_file, log);
+	const uint64_t hits = statistics.get(Statistics::SEED_HITS);
+	search_hash(command_line + " --sketch-seed-filter --freq-sd 20", db, query_file, log);
+	const uint64_t filtered_hits = statistics.get(Statistics::SEED_HITS), targets = statistics.get(Statistics::MATCHES);
+	const bool passed = filtered_hits > 0 && filtered_hits < hits && targets > 0;
+	print_result("seed sketch filter", passed, max_width);
+	return passed ? 1 : 0;
+}
+
+size_t run_testcase(size_t i, DatabaseFile &db, list<TextInputFile> &query_file, size_t max_width, bool bootstrap, bool log, bool to_cout) {
 	if (to_cout) {
-		Workflow::Search::run(opt);
+		search(test_cases[i].command_line, db, query_file, log, nullptr);
 		return 0;
 	}
 	
 	TempFile output_file(!bootstrap);
-	opt.consumer = &output_file;
-
-	Workflow::Search::run(opt);
+	search(test_cases[i].command_line, db, query_file, log, &output_file);
 
 	InputFile out_in(output_file);
 	uint64_t hash = out_in.hash();
@@ -80,11 +168,7 @@ size_t run_testcase(size_t i, DatabaseFile &db, list<TextInputFile> &query_file,
 		cout << "0x" << std::hex << hash << ',' << endl;
 	else {
 		const bool passed = hash == ref_hashes[i];
-		cout << std::setw(max_width) << std::left << test_cases[i].desc << " [ ";
-		set_color(passed ? Color::GREEN : Color::RED);
-		cout << (passed ? "Passed" : "Failed");
-		reset_color();
-		cout << " ]" << endl;
+		print_result(test_cases[i].desc, passed, max_width);
 		return passed ? 1 : 0;
 	}
 	return 0;
@@ -105,11 +189,17 @@ int run() {
 	make_db(&db_file, &query_file);
 	DatabaseFile db(*db_file);
 
-	const size_t n = test_cases.size(),
-		max_width = std::accumulate(test_cases.begin(), test_cases.end(), (size_t)0, [](size_t l, const TestCase& t) { return std::max(l, strlen(t.desc)); });
+	size_t n = test_cases.size();
+	const size_t max_width = std::accumulate(test_cases.begin(), test_cases.end(), (size_t)0, [](size_t l, const TestCase& t) { return std::max(l, strlen(t.desc)); });
 	size_t passed = 0;
 	for (size_t i = 0; i < n; ++i)
 		passed += run_testcase(i, db, query_file, max_width, bootstrap, log, to_cout);
+	if (!bootstrap && !to_cout) {
+		passed += test_cbs_batch(max_width);
+		passed += test_seed_index(db, query_file, max_width, log);
+		passed += test_seed_sketch(db, query_file, max_width, log);
+		n += 3;
+	}
 
 	cout << endl << "#Test cases passed: " << passed << '/' << n << endl; // << endl;
 	
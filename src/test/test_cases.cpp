@@ -38,13 +38,16 @@ const vector<TestCase> test_cases = {
 { "blastp (comp-based-stats 2)", "blastp --more-sensitive -c1 -p4 --comp-based-stats 2" },
 { "blastp (comp-based-stats 3)", "blastp --more-sensitive -c1 -p4 --comp-based-stats 3" },
 { "blastp (comp-based-stats 4)", "blastp --more-sensitive -c1 -p4 --comp-based-stats 4" },
+{ "blastp (cbs-batch 3)", "blastp --more-sensitive -c1 -p4 --comp-based-stats 3 --cbs-batch" },
+{ "blastp (cbs-batch 4)", "blastp --more-sensitive -c1 -p4 --comp-based-stats 4 --cbs-batch" },
 { "blastp (target seqs)", "blastp -k3 -c1 -p4" },
 { "blastp (top)", "blastp --top 10 -p4"},
 { "blastp (evalue)", "blastp -e10000 --more-sensitive -c1 -p4" },
 { "blastp (blosum50)", "blastp --matrix blosum50 -p4"},
 { "blastp (pairwise format)", "blastp -c1 -f0 -p4" },
 { "blastp (XML format)", "blastp -c1 -f xml -p4" },
-{ "blastp (PAF format)", "blastp -c1 -f paf -p1" }
+{ "blastp (PAF format)", "blastp -c1 -f paf -p1" },
+{ "blastp (saturated seed sketch)", "blastp --more-sensitive -c1 -p4 --sketch-seed-filter --sketch-width 4096" }
 };
 
 const vector<uint64_t> ref_hashes = {
@@ -60,6 +63,8 @@ const vector<uint64_t> ref_hashes = {
 0x8b983cbaaff963ff,
 0x113e1df71d47ee35,
 0xc955cd40c085e64d,
+0x113e1df71d47ee35,
+0xc955cd40c085e64d,
 0x92297cfae3e80486,
 0x563e4f33df3c673d,
 0x6a9d5bf640fc1f4b,
@@ -68,6 +73,7 @@ const vector<uint64_t> ref_hashes = {
 0x45e4056064e260c6,
 0xdffb0103534fe08f,
 0x778a9e9e5f7a6d64,
+0x6f1103a94ffd1a2b,
 };
 
 }
\ No newline at end of file
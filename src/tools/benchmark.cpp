@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <chrono>
+#include <random>
 #include <utility>
 #include <algorithm>
 #include <bitset>
@@ -39,6 +40,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../dp/scan_diags.h"
 #include "../stats/cbs.h"
 #include "../util/profiler.h"
+#include "../search/search.h"
+#include "../chaining/chaining.h"
 
 void benchmark_io();
 
@@ -64,6 +67,18 @@ void benchmark_hamming(const sequence &s1, const sequence &s2) {
 		volatile unsigned y = f1.match(f2);
 	}
 	cout << "SSE hamming distance:\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 48) * 1000 << " ps/Cell" << endl;
+
+#ifdef __AVX512BW__
+	{
+		high_resolution_clock::time_point t1 = high_resolution_clock::now();
+		Byte_finger_print_48_512 f1(s1.data()), f2(s2.data());
+		for (size_t i = 0; i < n; ++i) {
+			f1.r1 = _mm512_xor_si512(f1.r1, f2.r1);
+			volatile unsigned y = f1.match(f2);
+		}
+		cout << "AVX-512 hamming distance:\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 48) * 1000 << " ps/Cell" << endl;
+	}
+#endif
 }
 #endif
 
@@ -136,9 +151,64 @@ void benchmark_ungapped_sse(const sequence &s1, const sequence &s2) {
 		cout << "AVX2 ungapped extend:\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 32 * 64) * 1000 << " ps/Cell" << endl;
 	}
 #endif
+#if ARCH_ID == 3
+	{
+		high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+		const Letter* targets[64];
+		int out[64];
+		for (int i = 0; i < 64; ++i)
+			targets[i] = s2.data();
+
+		for (size_t i = 0; i < n; ++i) {
+			::DP::ARCH_AVX512::window_ungapped(s1.data(), targets, 64, 64, out);
+		}
+		cout << "AVX-512 ungapped extend:\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 64 * 64) * 1000 << " ps/Cell" << endl;
+	}
+#endif
 }
 #endif
 
+// Stage 2 ungapped verification of seed hits scattered over a reference block that does not fit into the cache. The
+// hit lists of the query offsets have geometrically distributed lengths with a mean of 4, like the lists left after
+// the fingerprint filter of stage 1, so most of them are shorter than a SIMD batch.
+void benchmark_stage2_prefetch() {
+	static const size_t ref_len = 256llu << 20, hits = 1llu << 22;
+	static const int window = 64;
+	std::minstd_rand rng(1);
+	vector<Letter> ref(ref_len), query(window);
+	for (Letter& l : ref)
+		l = Letter(rng() % 20);
+	for (Letter& l : query)
+		l = Letter(rng() % 20);
+	vector<const Letter*> subjects(hits);
+	vector<uint32_t> hit_idx(hits);
+	for (size_t i = 0; i < hits; ++i) {
+		subjects[i] = ref.data() + rng() % (ref_len - window);
+		hit_idx[i] = (uint32_t)i;
+	}
+	vector<size_t> limits(1, 0);
+	std::geometric_distribution<size_t> list_len(0.25);
+	while (limits.back() < hits)
+		limits.push_back(std::min(limits.back() + 1 + list_len(rng), hits));
+	vector<int> out(hits);
+
+	static const char* const modes[] = { "", " (prefetch per offset)", " (prefetch pipelined)" };
+	for (int mode = 0; mode < 3; ++mode) {
+		auto window_begin = [&subjects](uint32_t hit) { return subjects[hit]; };
+		::Search::WindowPrefetcher<decltype(window_begin)> prefetcher(hit_idx.data(), hit_idx.data() + hits, window, window_begin);
+		high_resolution_clock::time_point t1 = high_resolution_clock::now();
+		for (size_t i = 0; i < limits.size() - 1; ++i) {
+			const size_t begin = limits[i], n = limits[i + 1] - begin;
+			if (mode == 2)
+				prefetcher.advance(hit_idx.data() + limits[i + 1]);
+			::Search::DISPATCH_ARCH::window_ungapped_batches(query.data(), subjects.data() + begin, n, window, out.data() + begin, mode == 1 || (mode == 2 && n > decltype(prefetcher)::DISTANCE));
+		}
+		const double t = (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count();
+		cout << "Stage 2 ungapped" << modes[mode] << ":\t" << hits / t * 1000 << " M hits/s" << endl;
+	}
+}
+
 #ifdef __SSE2__
 void benchmark_transpose() {
 	static const size_t n = 10000000llu;
@@ -154,7 +224,7 @@ void benchmark_transpose() {
 	}
 	cout << "Matrix transpose 16x16 bytes:\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 256) * 1000 << " ps/Letter" << endl;
 
-#if ARCH_ID == 2
+#if ARCH_ID >= 2
 	{
 		static signed char in[32 * 32], out[32 * 32];
 		signed char* v[32];
@@ -195,7 +265,7 @@ void swipe_cell_update() {
 		}
 		volatile auto x = diagonal_cell.data_;
 	}
-	cout << "SWIPE cell update (int8_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 16) * 1000 << " ps/Cell" << endl;
+	cout << "SWIPE cell update (int8_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * ScoreTraits<score_vector<int8_t>>::CHANNELS) * 1000 << " ps/Cell" << endl;
 #endif
 }
 #endif
@@ -205,7 +275,7 @@ void swipe(const sequence &s1, const sequence &s2) {
 	constexpr int CHANNELS = ::DISPATCH_ARCH::ScoreTraits<score_vector<int8_t>>::CHANNELS;
 	static const size_t n = 1000llu;
 	vector<DpTarget> target8, target16;
-	for (size_t i = 0; i < 32; ++i)
+	for (int i = 0; i < CHANNELS; ++i)
 		target8.emplace_back(s2, 0, 0, 0, 0);
 	Bias_correction cbs(s1);
 	Statistics stat;
@@ -214,19 +284,19 @@ void swipe(const sequence &s1, const sequence &s2) {
 
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(query, target8, target16, nullptr, Frame(0), nullptr, DP::FULL_MATRIX, stat);
+		volatile HspList v = ::DP::BandedSwipe::swipe(query, target8, target16, nullptr, Frame(0), nullptr, DP::FULL_MATRIX, stat);
 	}
 	cout << "SWIPE (int8_t):\t\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * query.length() * s2.length() * CHANNELS) * 1000 << " ps/Cell" << endl;
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(query, target8, target16, nullptr, Frame(0), &cbs, DP::FULL_MATRIX, stat);
+		volatile HspList v = ::DP::BandedSwipe::swipe(query, target8, target16, nullptr, Frame(0), &cbs, DP::FULL_MATRIX, stat);
 	}
 	cout << "SWIPE (int8_t, CBS):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * query.length() * s2.length() * CHANNELS) * 1000 << " ps/Cell" << endl;
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(query, target8, target16, nullptr, Frame(0), nullptr, DP::FULL_MATRIX | DP::TRACEBACK, stat);
+		volatile HspList v = ::DP::BandedSwipe::swipe(query, target8, target16, nullptr, Frame(0), nullptr, DP::FULL_MATRIX | DP::TRACEBACK, stat);
 	}
 	cout << "SWIPE (int8_t, TB):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * query.length() * s2.length() * CHANNELS) * 1000 << " ps/Cell" << endl;
 }
@@ -324,12 +394,78 @@ void matrix_adjust(const sequence& s1, const sequence& s2) {
 	//Profiler::print(n);
 }
 
+// Repeat-rich query and target made of mutated copies of one domain, with the ungapped extensions of seeds in all
+// pairs of copies as input for the chaining.
+void chaining() {
+	static const int domain_len = 80, copies = 40, seeds_per_copy = 8;
+	static const size_t n = 10;
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> letter(0, 19), linker_len(5, 30), pct(0, 99);
+	vector<Letter> domain(domain_len);
+	for (Letter& l : domain)
+		l = (Letter)letter(rng);
+	auto repeats = [&](vector<int>& starts) {
+		vector<Letter> s{ sequence::DELIMITER };
+		for (int c = 0; c < copies; ++c) {
+			for (int k = linker_len(rng); k > 0; --k)
+				s.push_back((Letter)letter(rng));
+			starts.push_back((int)s.size() - 1);
+			for (Letter l : domain)
+				if (pct(rng) >= 3)
+					s.push_back(pct(rng) < 20 ? (Letter)letter(rng) : l);
+		}
+		s.push_back(sequence::DELIMITER);
+		return s;
+	};
+	vector<int> query_starts, target_starts;
+	const vector<Letter> q = repeats(query_starts), t = repeats(target_starts);
+	const sequence query(q.data() + 1, q.size() - 2), target(t.data() + 1, t.size() - 2);
+
+	vector<Diagonal_segment> segments;
+	for (int i : query_starts)
+		for (int j : target_starts)
+			for (int k = 0; k < seeds_per_copy; ++k) {
+				const int o = k * domain_len / seeds_per_copy;
+				if (i + o >= (int)query.length() || j + o >= (int)target.length())
+					continue;
+				const Diagonal_segment d = xdrop_ungapped(query, target, i + o, j + o);
+				if (d.score > 0 && (segments.empty() || !(segments.back() == d)))
+					segments.push_back(d);
+			}
+	std::stable_sort(segments.begin(), segments.end(), Diagonal_segment::cmp_diag);
+	cout << "Chaining:\t\t\t" << segments.size() << " segments, query length=" << query.length() << ", target length=" << target.length() << endl;
+
+	std::pair<int, list<Hsp_traits>> r;
+	high_resolution_clock::time_point t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i)
+		r = greedy_align(query, target, segments.begin(), segments.end(), false, 0);
+	cout << "Chaining (greedy):\t\t" << (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / n / 1000 << " ms, score=" << r.first << " hsps=" << r.second.size() << endl;
+
+	const double len_cap = config.chaining_len_cap;
+	config.chaining_len_cap = 0.0;
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i)
+		r = greedy_align(query, target, segments.begin(), segments.end(), false, 0);
+	cout << "Chaining (greedy, no cap):\t" << (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / n / 1000 << " ms, score=" << r.first << " hsps=" << r.second.size() << endl;
+	config.chaining_len_cap = len_cap;
+
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i)
+		r = sparse_chain(query, target, segments.begin(), segments.end(), false, 0);
+	cout << "Chaining (sparse):\t\t" << (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / n / 1000 << " ms, score=" << r.first << " hsps=" << r.second.size() << endl;
+}
+
 void benchmark() {
 	if (config.type == "io") {
 		benchmark_io();
 		return;
 	}
 
+	if (config.type == "chaining") {
+		chaining();
+		return;
+	}
+
 	vector<Letter> s1, s2, s3, s4;
 		
 	s1 = sequence::from_string("mpeeeysefkelilqkelhvvyalshvcgqdrtllasillriflhekleslllctlndreismedeattlfrattlastlmeqymkatatqfvhhalkdsilkimeskqscelspskleknedvntnlthllnilselvekifmaseilpptlryiygclqksvqhkwptnttmrtrvvsgfvflrlicpailnprmfniisdspspiaartlilvaksvqnlanlvefgakepymegvnpfiksnkhrmimfldelgnvpelpdttehsrtdlsrdlaalheicvahsdelrtlsnergaqqhvlkkllaitellqqkqnqyt"); // d1wera_
@@ -361,6 +497,7 @@ void benchmark() {
 #ifdef __SSE4_1__
 	benchmark_ungapped_sse(ss1, ss2);
 #endif
+	benchmark_stage2_prefetch();
 #ifdef __SSE2__
 	benchmark_transpose();
 #endif
@@ -28,6 +28,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <tuple>
 #include <iterator>
 #include <atomic>
+#include <mutex>
+#include <memory>
+#include <zlib.h>
 #include "../basic/config.h"
 #include "io/temp_file.h"
 #include "io/input_file.h"
@@ -42,19 +45,23 @@ struct Async_buffer
 
 	typedef std::vector<_t> Vector;
 
-	Async_buffer(size_t input_count, const std::string &tmpdir, unsigned bins) :
+	Async_buffer(size_t input_count, const std::string &tmpdir, unsigned bins, size_t memory_budget = 0, bool compress = false) :
 		bins_(bins),
 		bin_size_((input_count + bins_ - 1) / bins_),
 		input_count_(input_count),
+		memory_budget_(memory_budget),
+		compress_(compress),
 		bins_processed_(0),
-		total_disk_size_(0)
+		total_disk_size_(0),
+		memory_used_(0),
+		tmp_file_(bins),
+		mem_(bins),
+		mtx_(new std::mutex[bins])
 	{
 		log_stream << "Async_buffer() " << input_count << ',' << bin_size_ << std::endl;
 		count_ = new std::atomic_size_t[bins];
-		for (unsigned i = 0; i < bins; ++i) {
-			tmp_file_.push_back(new AsyncFile());
+		for (unsigned i = 0; i < bins; ++i)
 			count_[i] = (size_t)0;
-		}
 	}
 
 	~Async_buffer() {
@@ -78,9 +85,6 @@ struct Async_buffer
 			count_(parent.bins(), 0),
 			parent_(parent)
 		{
-			for (unsigned i = 0; i < parent.bins_; ++i) {
-				out_.push_back(&parent.tmp_file_[i]);
-			}
 		}
 		void push(unsigned id, const char *data, size_t size, size_t count)
 		{
@@ -93,7 +97,7 @@ struct Async_buffer
 		}
 		void flush(unsigned bin)
 		{
-			out_[bin]->write(buffer_[bin].data(), buffer_[bin].size());
+			parent_.write(bin, buffer_[bin].data(), buffer_[bin].size());
 			buffer_[bin].clear();
 		}
 		~Iterator()
@@ -107,7 +111,6 @@ struct Async_buffer
 		enum { buffer_size = 65536 };
 		std::vector<std::vector<char>> buffer_;
 		std::vector<size_t> count_;
-		std::vector<AsyncFile*> out_;
 		Async_buffer &parent_;
 	};
 
@@ -120,10 +123,10 @@ struct Async_buffer
 			data_next_ = nullptr;
 			return;
 		}
-		size_t size = count_[bins_processed_], end = bins_processed_ + 1, current_size, disk_size = tmp_file_[bins_processed_].tell();
+		size_t size = count_[bins_processed_], end = bins_processed_ + 1, current_size, disk_size = disk_size_of(bins_processed_);
 		while (end < bins_ && (size + (current_size = count_[end])) * sizeof(_t) < max_size) {
 			size += current_size;
-			disk_size += tmp_file_[end].tell();
+			disk_size += disk_size_of(end);
 			++end;
 		}
 		log_stream << "Async_buffer.load() " << size << "(" << (double)size * sizeof(_t) / (1 << 30) << " GB, " << (double)disk_size / (1 << 30) << " GB on disk)" << std::endl;
@@ -152,25 +155,88 @@ struct Async_buffer
 		return total_disk_size_;
 	}
 
+	// Number of entries and bytes of serialized data written so far.
+	size_t count() const {
+		size_t n = 0;
+		for (unsigned i = 0; i < bins_; ++i)
+			n += count_[i];
+		return n;
+	}
+
+	size_t data_size() {
+		size_t n = memory_used_;
+		for (unsigned i = 0; i < bins_; ++i)
+			n += disk_size_of(i);
+		return n;
+	}
+
 private:
 
+	// Keeps the data in memory as long as the budget allows, otherwise appends it to the temporary file of the bin.
+	void write(unsigned bin, const char *ptr, size_t size)
+	{
+		if (size == 0)
+			return;
+		if (memory_used_.fetch_add(size) + size <= memory_budget_) {
+			std::lock_guard<std::mutex> lock(mtx_[bin]);
+			mem_[bin].insert(mem_[bin].end(), ptr, ptr + size);
+			return;
+		}
+		memory_used_ -= size;
+		// Compressed outside of the lock, which is only needed for appending to the file.
+		thread_local std::vector<char> buf;
+		if (compress_) {
+			uLongf n = compressBound((uLong)size);
+			buf.resize(n);
+			if (compress2((Bytef*)buf.data(), &n, (const Bytef*)ptr, (uLong)size, Z_BEST_SPEED) != Z_OK)
+				throw std::runtime_error("Error compressing temporary data.");
+			ptr = buf.data();
+			size = n;
+		}
+		std::lock_guard<std::mutex> lock(mtx_[bin]);
+		if (tmp_file_.get(bin) == nullptr)
+			tmp_file_.get(bin) = new AsyncFile();
+		tmp_file_[bin].write(ptr, size);
+	}
+
+	size_t disk_size_of(size_t bin)
+	{
+		return tmp_file_.get(bin) ? tmp_file_[bin].tell() : 0;
+	}
+
 	void load_bin(std::vector<_t> &out, size_t bin)
 	{
-		InputFile f(tmp_file_[bin], InputStreamBuffer::ASYNC);
 		auto it = std::back_inserter(out);
 		size_t count = 0;
-		try {
-			while(true) count += _t::read(f, it);
-		} catch(EndOfStream&) {}
-		f.close_and_delete();
+		if (!mem_[bin].empty()) {
+			Deserializer d(mem_[bin].data(), mem_[bin].data() + mem_[bin].size());
+			try {
+				while (true) count += _t::read(d, it);
+			} catch (EndOfStream&) {}
+			memory_used_ -= mem_[bin].size();
+			std::vector<char>().swap(mem_[bin]);
+		}
+		std::string file_name;
+		if (tmp_file_.get(bin)) {
+			InputFile f(tmp_file_[bin], InputStreamBuffer::ASYNC | (compress_ ? InputFile::DECOMPRESS : 0));
+			try {
+				while (true) count += _t::read(f, it);
+			} catch (EndOfStream&) {}
+			f.close_and_delete();
+			file_name = f.file_name;
+		}
 		if (count != count_[bin])
-			throw std::runtime_error("Mismatching hit count / possibly corrupted temporary file: " + f.file_name);
+			throw std::runtime_error("Mismatching hit count / possibly corrupted temporary file: " + file_name);
 	}
 
 	const unsigned bins_;
-	const size_t bin_size_, input_count_;
+	const size_t bin_size_, input_count_, memory_budget_;
+	const bool compress_;
 	size_t bins_processed_, total_disk_size_;
+	std::atomic_size_t memory_used_;
 	PtrVector<AsyncFile> tmp_file_;
+	std::vector<std::vector<char>> mem_;
+	std::unique_ptr<std::mutex[]> mtx_;
 	std::atomic_size_t *count_;
 	std::pair<size_t, size_t> input_range_next_;
 	std::vector<_t>* data_next_;
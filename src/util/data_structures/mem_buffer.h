@@ -24,7 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 template<typename _t>
 struct MemBuffer {
 
-	enum { ALIGN = 32 };
+	enum { ALIGN = 64 };
 
 	typedef _t value_type;
 
@@ -56,7 +56,7 @@ size_t ZlibSource::read(char *ptr, size_t count)
 
 		int ret = inflate(&strm, Z_NO_FLUSH);
 		if (ret == Z_STREAM_END) {
-			int ret = inflateInit2(&strm, 15 + 32);
+			int ret = inflateReset(&strm);
 			if (ret != Z_OK)
 				throw std::runtime_error("Error initializing compressed stream (inflateInit): " + file_name());
 		}
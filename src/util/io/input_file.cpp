@@ -77,6 +77,8 @@ InputFile::InputFile(TempFile &tmp_file, int flags) :
 	unlinked(tmp_file.unlinked)
 {
 	tmp_file.rewind();
+	if (flags & DECOMPRESS)
+		buffer_ = new InputStreamBuffer(new ZlibSource(buffer_));
 }
 
 void InputFile::close_and_delete()
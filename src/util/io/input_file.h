@@ -35,7 +35,7 @@ struct TempFile;
 struct InputFile : public Deserializer
 {
 
-	enum { BUFFERED = 1, NO_AUTODETECT = 2 };
+	enum { BUFFERED = 1, NO_AUTODETECT = 2, DECOMPRESS = 8 };
 
 	InputFile(const string &file_name, int flags = 0);
 	InputFile(TempFile &tmp_file, int flags = 0);
@@ -32,6 +32,14 @@ void Serializer::flush()
 	buffer_->flush(next_ - begin_);
 }
 
+void Serializer::sync()
+{
+	flush();
+	reset_buffer();
+	if (file())
+		fflush(file());
+}
+
 void Serializer::close()
 {
 	flush();
@@ -121,6 +121,8 @@ struct Serializer : public Consumer
 	void seek(size_t pos);
 	void rewind();
 	size_t tell();
+	// Writes buffered data through to the file, so that it can be read back by another handle.
+	void sync();
 	void close();
 	std::string file_name() const;
 	FILE* file();
@@ -0,0 +1,220 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "pool_allocator.h"
+
+namespace Util { namespace Memory {
+
+struct FreeBlock {
+	FreeBlock* next;
+};
+
+struct FreeList {
+	FreeList() :
+		head(nullptr),
+		count(0)
+	{}
+	void push(FreeBlock* b) {
+		b->next = head;
+		head = b;
+		++count;
+	}
+	FreeBlock* pop() {
+		FreeBlock* b = head;
+		head = b->next;
+		--count;
+		return b;
+	}
+	void clear() {
+		head = nullptr;
+		count = 0;
+	}
+	FreeBlock* head;
+	size_t count;
+};
+
+struct SharedFreeList {
+	std::mutex mtx;
+	FreeList list;
+};
+
+struct ThreadCache;
+
+// Chunks and thread caches of the pool. The live counts of the thread caches only change on
+// their own thread, a block freed by another thread than the one that allocated it makes one
+// count negative and the other one positive.
+struct PoolState {
+	PoolState() :
+		epoch(0),
+		orphan_live(0)
+	{}
+	std::mutex mtx;
+	std::vector<char*> chunks;
+	std::vector<ThreadCache*> caches;
+	std::atomic<uint64_t> epoch;
+	std::atomic<int64_t> orphan_live;
+	SharedFreeList shared[FreeListPool::CLASSES];
+};
+
+static PoolState& pool_state() {
+	// Intentionally leaked so that blocks can still be freed during static destruction.
+	static PoolState* state = new PoolState;
+	return *state;
+}
+
+// Moves up to n blocks from one list to another, one of them being the shared list.
+static void move_blocks(FreeList& from, FreeList& to, size_t n) {
+	while (n-- > 0 && from.head != nullptr)
+		to.push(from.pop());
+}
+
+static void refill(FreeList& list, int size_class) {
+	PoolState& state = pool_state();
+	const size_t size = FreeListPool::block_size(size_class), n = FreeListPool::CHUNK_SIZE / size;
+	{
+		SharedFreeList& shared = state.shared[size_class];
+		std::lock_guard<std::mutex> lock(shared.mtx);
+		move_blocks(shared.list, list, n);
+	}
+	if (list.head != nullptr)
+		return;
+	char* chunk = (char*)malloc(FreeListPool::CHUNK_SIZE);
+	if (chunk == nullptr)
+		throw std::bad_alloc();
+	{
+		std::lock_guard<std::mutex> lock(state.mtx);
+		state.chunks.push_back(chunk);
+	}
+	for (size_t i = n; i > 0; --i)
+		list.push((FreeBlock*)(chunk + (i - 1) * size));
+}
+
+static void release(FreeList& list, int size_class, size_t n) {
+	SharedFreeList& shared = pool_state().shared[size_class];
+	std::lock_guard<std::mutex> lock(shared.mtx);
+	move_blocks(list, shared.list, n);
+}
+
+// Set once the cache of the thread has been destroyed. Blocks used by thread_local objects
+// destroyed later on are then taken from and returned to the shared lists directly.
+static thread_local bool cache_destroyed = false;
+
+struct ThreadCache {
+	ThreadCache() :
+		live(0)
+	{
+		PoolState& state = pool_state();
+		std::lock_guard<std::mutex> lock(state.mtx);
+		epoch = state.epoch.load(std::memory_order_relaxed);
+		state.caches.push_back(this);
+	}
+	~ThreadCache() {
+		PoolState& state = pool_state();
+		std::lock_guard<std::mutex> lock(state.mtx);
+		if (epoch == state.epoch.load(std::memory_order_relaxed))
+			for (int i = 0; i < FreeListPool::CLASSES; ++i)
+				release(lists[i], i, lists[i].count);
+		state.orphan_live += live.load(std::memory_order_relaxed);
+		state.caches.erase(std::find(state.caches.begin(), state.caches.end(), this));
+		cache_destroyed = true;
+	}
+	// Drops the free lists if the pool has been reset since their last use.
+	void check_epoch() {
+		const uint64_t e = pool_state().epoch.load(std::memory_order_relaxed);
+		if (epoch == e)
+			return;
+		for (int i = 0; i < FreeListPool::CLASSES; ++i)
+			lists[i].clear();
+		epoch = e;
+	}
+	void add_live(int64_t n) {
+		live.store(live.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+	FreeList lists[FreeListPool::CLASSES];
+	std::atomic<int64_t> live;
+	uint64_t epoch;
+};
+
+static ThreadCache& thread_cache() {
+	static thread_local ThreadCache cache;
+	cache.check_epoch();
+	return cache;
+}
+
+void* FreeListPool::allocate_block(int size_class) {
+	if (cache_destroyed) {
+		FreeList list;
+		refill(list, size_class);
+		void* p = list.pop();
+		release(list, size_class, list.count);
+		++pool_state().orphan_live;
+		return p;
+	}
+	ThreadCache& cache = thread_cache();
+	FreeList& list = cache.lists[size_class];
+	if (list.head == nullptr)
+		refill(list, size_class);
+	cache.add_live(1);
+	return list.pop();
+}
+
+void FreeListPool::deallocate_block(void* p, int size_class) {
+	if (cache_destroyed) {
+		FreeList list;
+		list.push((FreeBlock*)p);
+		release(list, size_class, 1);
+		--pool_state().orphan_live;
+		return;
+	}
+	ThreadCache& cache = thread_cache();
+	FreeList& list = cache.lists[size_class];
+	list.push((FreeBlock*)p);
+	cache.add_live(-1);
+	if (list.count * block_size(size_class) > CACHE_CHUNKS * CHUNK_SIZE)
+		release(list, size_class, list.count / 2);
+}
+
+bool FreeListPool::reset() {
+	PoolState& state = pool_state();
+	std::lock_guard<std::mutex> lock(state.mtx);
+	int64_t live = state.orphan_live;
+	for (const ThreadCache* cache : state.caches)
+		live += cache->live.load(std::memory_order_relaxed);
+	if (live != 0)
+		return false;
+	for (int i = 0; i < CLASSES; ++i) {
+		std::lock_guard<std::mutex> lock(state.shared[i].mtx);
+		state.shared[i].list.clear();
+	}
+	for (char* chunk : state.chunks)
+		free(chunk);
+	state.chunks.clear();
+	state.chunks.shrink_to_fit();
+	++state.epoch;
+	return true;
+}
+
+}}
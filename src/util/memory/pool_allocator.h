@@ -0,0 +1,121 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <cstddef>
+#include <new>
+
+namespace Util { namespace Memory {
+
+// Size class free lists for small, frequently recycled objects like HSP list nodes and
+// transcripts. Each thread keeps its own cache of free blocks, so steady state allocation
+// does not take locks or call into malloc. Surplus blocks of a thread are moved to a shared
+// list, so a block may be freed by any thread. Size classes are multiples of 16 bytes up
+// to 64 bytes and four classes per doubling above, which bounds the internal waste to 25%.
+// The HSP lists themselves are still linked lists, the planned switch to pooled vectors of
+// HSP indices has not been done.
+struct FreeListPool {
+
+	enum { MIN_SIZE = 16, CLASSES = 24, MAX_SIZE = 2048, CHUNK_SIZE = 64 * 1024, CACHE_CHUNKS = 4 };
+
+	static void* allocate(size_t n) {
+		if (n > MAX_SIZE)
+			return ::operator new(n);
+		return allocate_block(size_class(n));
+	}
+
+	static void deallocate(void* p, size_t n) {
+		if (n > MAX_SIZE)
+			::operator delete(p);
+		else
+			deallocate_block(p, size_class(n));
+	}
+
+	// Returns all chunks to the system, to be called at the end of a block while no other
+	// thread uses the pool. Does nothing and returns false if any pooled block is still
+	// allocated.
+	static bool reset();
+
+	static size_t block_size(int size_class) {
+		if (size_class < 4)
+			return size_t(size_class + 1) * MIN_SIZE;
+		return size_t(5 + (size_class & 3)) << (size_class / 4 + 3);
+	}
+
+private:
+
+	static int size_class(size_t n) {
+		if (n <= 4 * MIN_SIZE)
+			return n == 0 ? 0 : int((n - 1) / MIN_SIZE);
+		const size_t m = n - 1;
+		int b = 6;
+		while ((m >> (b + 1)) != 0)
+			++b;
+		return 4 + (b - 6) * 4 + int((m >> (b - 2)) & 3);
+	}
+
+	static void* allocate_block(int size_class);
+	static void deallocate_block(void* p, int size_class);
+
+};
+
+template<typename T>
+struct PoolAllocator {
+
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template<typename T2>
+	struct rebind {
+		typedef PoolAllocator<T2> other;
+	};
+
+	PoolAllocator() noexcept {}
+
+	template<typename T2>
+	PoolAllocator(const PoolAllocator<T2>&) noexcept {}
+
+	T* allocate(size_t n) {
+		return (T*)FreeListPool::allocate(n * sizeof(T));
+	}
+
+	void deallocate(T* p, size_t n) {
+		FreeListPool::deallocate(p, n * sizeof(T));
+	}
+
+	// The allocator is stateless, so containers using it can splice and swap freely.
+	template<typename T2>
+	bool operator==(const PoolAllocator<T2>&) const {
+		return true;
+	}
+
+	template<typename T2>
+	bool operator!=(const PoolAllocator<T2>&) const {
+		return false;
+	}
+
+};
+
+}}
@@ -0,0 +1,78 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <atomic>
+#include <vector>
+#include <memory>
+#include "thread_pool.h"
+
+namespace Util { namespace Parallel {
+
+// Hands out the indices [begin, end) split into one contiguous share per NUMA node of the
+// process wide pool. Workers take indices from the share of their own node and only steal
+// from the shares of other nodes once it is exhausted. With a single node this is a plain
+// shared counter.
+struct NodeLocalQueue {
+
+	NodeLocalQueue(size_t begin, size_t end, size_t nodes = ThreadPool::get().node_count()) :
+		end_(end),
+		bounds_(nodes + 1),
+		next_(new Counter[nodes])
+	{
+		for (size_t i = 0; i <= nodes; ++i)
+			bounds_[i] = begin + (end - begin) * i / nodes;
+		for (size_t i = 0; i < nodes; ++i)
+			next_[i].value = bounds_[i];
+	}
+
+	// Returns end() if all indices have been handed out.
+	size_t next() {
+		const size_t nodes = bounds_.size() - 1, node = ThreadPool::node_id() % nodes;
+		for (size_t i = 0; i < nodes; ++i) {
+			const size_t n = (node + i) % nodes;
+			if (next_[n].value.load(std::memory_order_relaxed) >= bounds_[n + 1])
+				continue;
+			const size_t j = next_[n].value++;
+			if (j < bounds_[n + 1])
+				return j;
+		}
+		return end_;
+	}
+
+	size_t end() const {
+		return end_;
+	}
+
+private:
+
+	// Padded to keep the counters of different nodes on separate cache lines.
+	struct Counter {
+		std::atomic<size_t> value;
+		char padding[64 - sizeof(std::atomic<size_t>)];
+	};
+
+	const size_t end_;
+	std::vector<size_t> bounds_;
+	std::unique_ptr<Counter[]> next_;
+
+};
+
+}}
@@ -0,0 +1,299 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2020 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <benjamin.buchfink@tue.mpg.de>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <stdexcept>
+#include "thread_pool.h"
+#include "../system/system.h"
+
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+
+namespace Util { namespace Parallel {
+
+thread_local ThreadPool* ThreadPool::current_ = nullptr;
+thread_local size_t ThreadPool::queue_id_ = 0;
+
+static mutex global_mtx;
+static ThreadPool* global_pool = nullptr;
+static size_t global_thread_count = 0;
+static bool global_affinity = false, global_numa = false;
+
+static void set_affinity(const std::vector<int>& cpus) {
+#ifdef __linux__
+	if (cpus.empty())
+		return;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu : cpus)
+		CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+ThreadPool::ThreadPool(size_t thread_count, bool affinity, bool numa) :
+	queued_(0),
+	pending_(0),
+	affinity_(affinity),
+	numa_(numa),
+	node_cpus_(numa ? numa_nodes() : std::vector<std::vector<int>>()),
+	worker_node_(thread_count + 1, 0),
+	node_count_(std::max(node_cpus_.size(), (size_t)1)),
+	stop_(false),
+	source_(nullptr),
+	max_source_concurrency_(0),
+	source_active_(0),
+	source_done_(true),
+	waiting_(0)
+{
+	if (node_count_ > thread_count)
+		node_count_ = std::max(thread_count, (size_t)1);
+	for (size_t i = 0; i < thread_count; ++i)
+		worker_node_[i] = i * node_count_ / thread_count;
+	for (size_t i = 0; i <= thread_count; ++i)
+		queues_.emplace_back(new WorkQueue);
+	for (size_t i = 0; i < thread_count; ++i)
+		threads_.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> lock(mtx_);
+		stop_ = true;
+		cv_.notify_all();
+	}
+	for (std::thread& t : threads_)
+		t.join();
+}
+
+void ThreadPool::init(size_t thread_count, bool affinity, bool numa) {
+	lock_guard<mutex> lock(global_mtx);
+	global_thread_count = thread_count;
+	global_affinity = affinity;
+	global_numa = numa;
+	if (global_pool && (global_pool->thread_count() != thread_count || global_pool->affinity_ != affinity || global_pool->numa_ != numa)) {
+		{
+			lock_guard<mutex> lock(global_pool->mtx_);
+			if (current_ == global_pool || global_pool->pending_ > 0 || global_pool->source_)
+				throw std::runtime_error("The thread pool cannot be reconfigured while it is in use.");
+		}
+		delete global_pool;
+		global_pool = nullptr;
+	}
+}
+
+ThreadPool& ThreadPool::get() {
+	lock_guard<mutex> lock(global_mtx);
+	// Intentionally leaked, the workers are idle when the program exits.
+	if (!global_pool)
+		global_pool = new ThreadPool(global_thread_count ? global_thread_count : std::max(std::thread::hardware_concurrency(), 1u), global_affinity, global_numa);
+	return *global_pool;
+}
+
+void ThreadPool::enqueue(TaskSet& set, Task task) {
+	++set.pending;
+	++pending_;
+	// Counted before the task is published, so that pop() can not decrement the counter first.
+	++queued_;
+	WorkQueue& q = *queues_[current_ == this ? queue_id_ : threads_.size()];
+	{
+		lock_guard<mutex> lock(q.mtx);
+		q.tasks.push_back({ std::move(task), &set });
+	}
+	lock_guard<mutex> lock(mtx_);
+	cv_.notify_one();
+	if (waiting_ > 0)
+		done_cv_.notify_all();
+}
+
+bool ThreadPool::pop(size_t queue, Entry& e) {
+	if (queued_ == 0)
+		return false;
+	const size_t n = queues_.size();
+	{
+		WorkQueue& q = *queues_[queue];
+		lock_guard<mutex> lock(q.mtx);
+		if (!q.tasks.empty()) {
+			e = std::move(q.tasks.back());
+			q.tasks.pop_back();
+			--queued_;
+			return true;
+		}
+	}
+	for (size_t i = 1; i < n; ++i) {
+		WorkQueue& q = *queues_[(queue + i) % n];
+		lock_guard<mutex> lock(q.mtx);
+		if (!q.tasks.empty()) {
+			e = std::move(q.tasks.front());
+			q.tasks.pop_front();
+			--queued_;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::execute(Entry& e) {
+	TaskSet* set = e.set;
+	try {
+		e.task();
+	}
+	catch (...) {
+		lock_guard<mutex> lock(mtx_);
+		if (!set->exception)
+			set->exception = std::current_exception();
+	}
+	e.task = nullptr;
+	--pending_;
+	if (--set->pending == 0) {
+		lock_guard<mutex> lock(mtx_);
+		done_cv_.notify_all();
+	}
+}
+
+void ThreadPool::wait(TaskSet& set) {
+	if (current_ == this) {
+		// Run queued tasks until the set is complete, sleep while all remaining ones are running elsewhere.
+		Entry e;
+		while (set.pending > 0) {
+			if (pop(queue_id_, e)) {
+				execute(e);
+				continue;
+			}
+			unique_lock<mutex> lock(mtx_);
+			++waiting_;
+			done_cv_.wait(lock, [this, &set] { return set.pending == 0 || queued_ > 0; });
+			--waiting_;
+		}
+	}
+	else {
+		unique_lock<mutex> lock(mtx_);
+		done_cv_.wait(lock, [&set] { return set.pending == 0; });
+	}
+	if (set.exception) {
+		std::exception_ptr e = set.exception;
+		set.exception = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+void ThreadPool::run(const Source& source, size_t max_concurrency) {
+	if (current_ == this) {
+		while (source(queue_id_));
+		return;
+	}
+	lock_guard<mutex> run_lock(run_mtx_);
+	unique_lock<mutex> lock(mtx_);
+	source_ = &source;
+	max_source_concurrency_ = max_concurrency;
+	source_active_ = 0;
+	source_done_ = false;
+	cv_.notify_all();
+	done_cv_.wait(lock, [this] { return source_done_ && source_active_ == 0; });
+	source_ = nullptr;
+	if (source_exception_) {
+		std::exception_ptr e = source_exception_;
+		source_exception_ = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+const ThreadPool::Source* ThreadPool::take_source() {
+	if (source_done_ || source_active_ >= max_source_concurrency_)
+		return nullptr;
+	++source_active_;
+	return source_;
+}
+
+void ThreadPool::worker(size_t thread_id) {
+	current_ = this;
+	queue_id_ = thread_id;
+	if (!node_cpus_.empty()) {
+		const std::vector<int>& cpus = node_cpus_[worker_node_[thread_id]];
+		if (affinity_) {
+			// Position of the worker within the group assigned to its node.
+			size_t first = thread_id;
+			while (first > 0 && worker_node_[first - 1] == worker_node_[thread_id])
+				--first;
+			set_affinity({ cpus[(thread_id - first) % cpus.size()] });
+		}
+		else
+			set_affinity(cpus);
+	}
+	else if (affinity_) {
+		const size_t cpus = std::thread::hardware_concurrency();
+		if (cpus > 0)
+			set_affinity({ int(thread_id % cpus) });
+	}
+	Entry e;
+	while (true) {
+		if (pop(thread_id, e)) {
+			execute(e);
+			continue;
+		}
+		const Source* source;
+		{
+			unique_lock<mutex> lock(mtx_);
+			if (queued_ > 0)
+				continue;
+			if (stop_)
+				break;
+			source = take_source();
+			if (!source) {
+				cv_.wait(lock);
+				continue;
+			}
+		}
+		bool more;
+		std::exception_ptr exception;
+		try {
+			more = (*source)(thread_id);
+		}
+		catch (...) {
+			more = false;
+			exception = std::current_exception();
+		}
+		lock_guard<mutex> lock(mtx_);
+		--source_active_;
+		if (!more)
+			source_done_ = true;
+		if (exception && !source_exception_)
+			source_exception_ = exception;
+		if (source_done_ && source_active_ == 0)
+			done_cv_.notify_all();
+	}
+	current_ = nullptr;
+}
+
+void run_tasks(size_t n, const std::function<void(size_t)>& f) {
+	ThreadPool* pool = ThreadPool::current();
+	if (!pool)
+		pool = &ThreadPool::get();
+	ThreadPool::TaskSet tasks;
+	for (size_t i = 0; i < n; ++i)
+		pool->enqueue(tasks, [&f, i]() { f(i); });
+	pool->wait(tasks);
+}
+
+}}
@@ -4,9 +4,182 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <limits>
+#include <exception>
+#include <algorithm>
 
 namespace Util { namespace Parallel {
 
+// Persistent work stealing thread pool. Every worker owns a deque of tasks, pops from its back
+// and steals from the front of the other deques. A worker that finds no task pulls the next item
+// of work from the source function passed to run() (e.g. the next query), so tasks spawned by an
+// expensive item are always picked up before new items are started.
+// The process wide instance returned by get() is created on first use and lives until the
+// program exits, so the cost of starting threads is only paid once and thread local caches
+// of the workers persist across blocks and shapes.
+struct ThreadPool {
+
+	struct TaskSet {
+		TaskSet() :
+			pending(0)
+		{}
+		std::atomic<size_t> pending;
+		std::exception_ptr exception;
+	};
+
+	typedef std::function<void()> Task;
+	// Processes the next item of work on the given worker, returns false if there is none left.
+	typedef std::function<bool(size_t thread_id)> Source;
+
+	// In NUMA mode the workers are assigned to the nodes of the system in contiguous groups and
+	// bound to the CPUs of their node. With affinity, every worker is pinned to a single CPU.
+	ThreadPool(size_t thread_count, bool affinity = false, bool numa = false);
+	~ThreadPool();
+	void enqueue(TaskSet& set, Task task);
+	// Waits until all tasks of the set have completed and rethrows the first exception thrown
+	// by one of them. Workers of the pool run queued tasks while waiting.
+	void wait(TaskSet& set);
+	// Calls the source on up to max_concurrency workers until it returns false.
+	void run(const Source& source, size_t max_concurrency = std::numeric_limits<size_t>::max());
+	size_t thread_count() const {
+		return threads_.size();
+	}
+	// The pool the calling thread is a worker of, or nullptr.
+	static ThreadPool* current() {
+		return current_;
+	}
+	// Index of the calling worker thread, thread_count() for threads not owned by the pool.
+	static size_t worker_id() {
+		return current_ ? queue_id_ : get().thread_count();
+	}
+	// NUMA node of the calling worker thread, 0 for threads not owned by the pool.
+	static size_t node_id() {
+		return current_ ? current_->worker_node_[queue_id_] : 0;
+	}
+	// Number of NUMA nodes the workers are spread over, 1 if NUMA mode is off.
+	size_t node_count() const {
+		return node_count_;
+	}
+	// Sets the size, CPU affinity and NUMA mode of the process wide pool. An existing pool with
+	// different settings is replaced. Throws if that pool still has tasks or a run() in progress.
+	static void init(size_t thread_count, bool affinity, bool numa = false);
+	static ThreadPool& get();
+
+private:
+
+	struct Entry {
+		Task task;
+		TaskSet* set;
+	};
+
+	struct WorkQueue {
+		std::mutex mtx;
+		std::deque<Entry> tasks;
+	};
+
+	bool pop(size_t queue, Entry& e);
+	void execute(Entry& e);
+	const Source* take_source();
+	void worker(size_t thread_id);
+
+	// One queue per worker plus one for tasks enqueued by other threads.
+	std::vector<std::unique_ptr<WorkQueue>> queues_;
+	std::vector<std::thread> threads_;
+	// Tasks in the queues, and tasks enqueued and not yet completed.
+	std::atomic<size_t> queued_, pending_;
+	const bool affinity_, numa_;
+	std::vector<std::vector<int>> node_cpus_;
+	std::vector<size_t> worker_node_;
+	size_t node_count_;
+	bool stop_;
+
+	// State of the current run() call, guarded by mtx_.
+	const Source* source_;
+	size_t max_source_concurrency_, source_active_;
+	bool source_done_;
+	std::exception_ptr source_exception_;
+	// Number of workers blocked in wait(), guarded by mtx_.
+	size_t waiting_;
+
+	std::mutex mtx_, run_mtx_;
+	std::condition_variable cv_, done_cv_;
+
+	static thread_local ThreadPool* current_;
+	static thread_local size_t queue_id_;
+
+};
+
+// Group of tasks run on the process wide pool that are waited for as a unit. Exceptions of the
+// tasks are rethrown by wait(), which callers have to call explicitly. The destructor only
+// waits for tasks still pending when the group is left by an exception and discards theirs.
+struct TaskGroup {
+	TaskGroup(ThreadPool& pool = ThreadPool::get()) :
+		pool_(pool)
+	{}
+	~TaskGroup() {
+		if (set_.pending > 0) {
+			try {
+				pool_.wait(set_);
+			}
+			catch (...) {
+			}
+		}
+	}
+	void run(ThreadPool::Task task) {
+		pool_.enqueue(set_, std::move(task));
+	}
+	void wait() {
+		pool_.wait(set_);
+	}
+private:
+	ThreadPool& pool_;
+	ThreadPool::TaskSet set_;
+};
+
+// Runs f(i) for i in [0, n) as tasks of the process wide pool. Called from a pool worker, the
+// caller takes part in running them, so nested fan-outs of busy workers are picked up by idle ones.
+void run_tasks(size_t n, const std::function<void(size_t)>& f);
+
+// Calls f(i) for i in [begin, end), handing out chunks of grain_size indices to the workers.
+template<typename _f>
+void parallel_for(size_t begin, size_t end, _f f, size_t grain_size = 1) {
+	if (begin >= end)
+		return;
+	std::atomic<size_t> next(begin);
+	const size_t chunks = (end - begin + grain_size - 1) / grain_size;
+	run_tasks(std::min(chunks, ThreadPool::get().thread_count()), [&](size_t) {
+		size_t i;
+		while ((i = next.fetch_add(grain_size)) < end)
+			for (size_t j = i; j < std::min(i + grain_size, end); ++j)
+				f(j);
+	});
+}
+
+// Per worker storage for scratch buffers that are reused across tasks. Must only be accessed
+// from tasks running on the process wide pool.
+template<typename _t>
+struct WorkerLocal {
+	WorkerLocal() :
+		data_(ThreadPool::get().thread_count() + 1)
+	{}
+	_t& get() {
+		return data_[ThreadPool::worker_id()];
+	}
+	typename std::vector<_t>::iterator begin() {
+		return data_.begin();
+	}
+	typename std::vector<_t>::iterator end() {
+		return data_.end();
+	}
+private:
+	std::vector<_t> data_;
+};
+
 template<typename _f, typename... _args>
 void pool_worker(std::atomic<size_t> *partition, size_t thread_id, size_t partition_count, _f f, _args... args) {
 	size_t p;
@@ -18,18 +191,15 @@ void pool_worker(std::atomic<size_t> *partition, size_t thread_id, size_t partit
 template<typename _f, typename... _args>
 void scheduled_thread_pool(size_t thread_count, _f f, _args... args) {
 	std::atomic<size_t> partition(0);
-	std::vector<std::thread> threads;
-	for (size_t i = 0; i < thread_count; ++i)
-		threads.emplace_back(f, &partition, i, args...);
-	for (std::thread &t : threads)
-		t.join();
+	run_tasks(thread_count, [&partition, f, args...](size_t i) { f(&partition, i, args...); });
 }
 
 template<typename _f, typename... _args>
 void scheduled_thread_pool_auto(size_t thread_count, size_t partition_count, _f f, _args... args) {
-	scheduled_thread_pool(thread_count, pool_worker<_f, _args...>, partition_count, f, args...);
+	std::atomic<size_t> partition(0);
+	run_tasks(thread_count, [&partition, partition_count, f, args...](size_t i) { pool_worker<_f, _args...>(&partition, i, partition_count, f, args...); });
 }
 
 }}
 
-#endif
\ No newline at end of file
+#endif
@@ -18,27 +18,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <limits>
 #include <mutex>
-#include <condition_variable>
 
 struct Queue
 {
 	enum { end = size_t(-1) };
 	Queue(size_t begin, size_t end) :
 		next_(begin),
-		block_(false),
 		end_(end)
 	{}
 	template<typename _f>
 	size_t get(_f &f)
 	{
-		std::unique_lock<std::mutex> lock(mtx_);
-		while (block_)
-			cond_.wait(lock);
+		std::lock_guard<std::mutex> lock(mtx_);
 		const size_t q = next_++;
 		if (q >= end_) {
 			return Queue::end;
 		}
-		block_ = f(q);
+		f(q);
 		return q;
 	}
 	size_t next() const
@@ -49,14 +45,8 @@ struct Queue
 	{
 		return end_;
 	}
-	void release() {
-		block_ = false;
-		cond_.notify_all();
-	}
 private:
 	std::mutex mtx_;
-	std::condition_variable cond_;
 	volatile size_t next_;
-	volatile bool block_;
 	const size_t end_;
-};
\ No newline at end of file
+};
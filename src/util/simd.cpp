@@ -37,6 +37,19 @@ inline void cpuid(int CPUInfo[4], int InfoType) {
 #endif
 #endif
 
+#ifdef __SSE2__
+// Reads the extended control register, i.e. which register states the OS saves on context switches.
+static inline unsigned long long xgetbv(unsigned index) {
+#ifdef _WIN32
+	return _xgetbv(index);
+#else
+	unsigned eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (index));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
 namespace SIMD {
 
 int flags = 0;
@@ -58,10 +71,14 @@ Arch init_arch() {
 		flags |= POPCNT;
 	if ((info[2] & (1 << 19)) != 0)
 		flags |= SSE4_1;
+	// The 512 bit registers are only usable if the OS has enabled saving the opmask and ZMM states (XCR0 bits 5-7).
+	const bool os_zmm = (info[2] & (1 << 27)) != 0 && (xgetbv(0) & 0xe6) == 0xe6;
 	if (nids >= 7) {
 		cpuid(info, 7);
 		if ((info[1] & (1 << 5)) != 0)
 			flags |= AVX2;
+		if (os_zmm && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0 && (info[1] & (1 << 31)) != 0)
+			flags |= AVX512;
 	}
 #endif
 
@@ -81,7 +98,13 @@ Arch init_arch() {
 	if ((flags & AVX2) == 0)
 		throw std::runtime_error("CPU does not support AVX2. Please compile the software from source.");
 #endif
+#ifdef __AVX512BW__
+	if ((flags & AVX512) == 0)
+		throw std::runtime_error("CPU does not support AVX-512. Please compile the software from source.");
+#endif
 
+	if ((flags & SSSE3) && (flags & POPCNT) && (flags & SSE4_1) && (flags & AVX2) && (flags & AVX512))
+		return Arch::AVX512;
 	if ((flags & SSSE3) && (flags & POPCNT) && (flags & SSE4_1) && (flags & AVX2))
 		return Arch::AVX2;
 	if ((flags & SSSE3) && (flags & POPCNT) && (flags & SSE4_1))
@@ -105,6 +128,8 @@ std::string features() {
 		r.push_back("sse4.1");
 	if (flags & AVX2)
 		r.push_back("avx2");
+	if (flags & AVX512)
+		r.push_back("avx512f avx512bw avx512vl");
 	return r.empty() ? "None" : join(" ", r);
 }
 
@@ -47,8 +47,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace SIMD {
 
-enum class Arch { None, Generic, SSE4_1, AVX2 };
-enum Flags { SSSE3 = 1, POPCNT = 2, SSE4_1 = 4, AVX2 = 8 };
+enum class Arch { None, Generic, SSE4_1, AVX2, AVX512 };
+enum Flags { SSSE3 = 1, POPCNT = 2, SSE4_1 = 4, AVX2 = 8, AVX512 = 16 };
 Arch arch();
 
 std::string features();
@@ -136,10 +136,12 @@ inline void print_16(__m256i x, std::ostream& s) {
 #define DECL_DISPATCH(ret, name, param) namespace ARCH_GENERIC { ret name param; }\
 namespace ARCH_SSE4_1 { ret name param; }\
 namespace ARCH_AVX2 { ret name param; }\
+namespace ARCH_AVX512 { ret name param; }\
 static inline std::function<decltype(ARCH_GENERIC::name)> dispatch_target_##name() {\
 switch(::SIMD::arch()) {\
 case ::SIMD::Arch::SSE4_1: return ARCH_SSE4_1::name;\
 case ::SIMD::Arch::AVX2: return ARCH_AVX2::name;\
+case ::SIMD::Arch::AVX512: return ARCH_AVX512::name;\
 default: return ARCH_GENERIC::name;\
 }}\
 const std::function<decltype(ARCH_GENERIC::name)> name = dispatch_target_##name();
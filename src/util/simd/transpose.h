@@ -25,6 +25,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "transpose16x16.h"
 #endif
 
-#if ARCH_ID == 2
+#if ARCH_ID >= 2
 #include "transpose32x32.h"
 #endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <string.h>
 #include <iostream>
+#include <fstream>
 #include "system.h"
 #include "../string/string.h"
 #include "../log_stream.h"
@@ -160,7 +161,7 @@ double total_ram() {
 #define handle_error(msg) \
            do { perror(msg); exit(EXIT_FAILURE); } while (0)
 
-std::tuple<char*, size_t, int> mmap_file(const char* filename) {
+std::tuple<char*, size_t, int> mmap_file(const char* filename, bool copy_on_write) {
 #ifdef WIN32
 	return { nullptr, 0, -1 };
 #else
@@ -178,8 +179,8 @@ std::tuple<char*, size_t, int> mmap_file(const char* filename) {
 
 	length = sb.st_size;
 
-	addr = mmap(NULL, length, PROT_READ,
-		MAP_SHARED, fd, 0);
+	addr = copy_on_write ? mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+		: mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
 	if (addr == MAP_FAILED)
 		handle_error("mmap");
 	return { (char*)addr, length, fd };
@@ -192,4 +193,59 @@ void unmap_file(char* ptr, size_t size, int fd) {
 	munmap((void*)ptr, size);
 	close(fd);
 #endif
-}
\ No newline at end of file
+}
+
+// Maps the range [offset, offset + length) of a file copy-on-write. Returns a pointer to offset
+// (or nullptr on failure) and sets map_size to the mapped length for unmap_file_range.
+char* mmap_file_range(const char* filename, size_t offset, size_t length, size_t& map_size) {
+#ifdef WIN32
+	return nullptr;
+#else
+	const size_t page = (size_t)sysconf(_SC_PAGESIZE), delta = offset % page;
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1)
+		return nullptr;
+	void* addr = mmap(NULL, length + delta, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset - delta);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return nullptr;
+	map_size = length;
+	return (char*)addr + delta;
+#endif
+}
+
+void unmap_file_range(char* ptr, size_t size) {
+#ifdef WIN32
+#else
+	const size_t page = (size_t)sysconf(_SC_PAGESIZE), delta = (size_t)ptr % page;
+	munmap((void*)(ptr - delta), size + delta);
+#endif
+}
+
+std::vector<std::vector<int>> numa_nodes() {
+	std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+	for (int node = 0;; ++node) {
+		std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if (!f.good())
+			break;
+		string list;
+		std::getline(f, list);
+		std::vector<int> cpus;
+		const char* p = list.c_str();
+		while (*p >= '0' && *p <= '9') {
+			char* end;
+			const int first = (int)strtol(p, &end, 10);
+			int last = first;
+			if (*end == '-')
+				last = (int)strtol(end + 1, &end, 10);
+			for (int i = first; i <= last; ++i)
+				cpus.push_back(i);
+			p = *end == ',' ? end + 1 : end;
+		}
+		if (!cpus.empty())
+			nodes.push_back(std::move(cpus));
+	}
+#endif
+	return nodes;
+}
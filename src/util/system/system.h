@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string>
 #include <tuple>
+#include <vector>
 
 enum class Color { RED, GREEN, YELLOW };
 
@@ -16,8 +17,12 @@ size_t getPeakRSS();
 void log_rss();
 size_t file_size(const char* name);
 double total_ram();
-std::tuple<char*, size_t, int> mmap_file(const char* filename);
+std::tuple<char*, size_t, int> mmap_file(const char* filename, bool copy_on_write = false);
 void unmap_file(char* ptr, size_t size, int fd);
+char* mmap_file_range(const char* filename, size_t offset, size_t length, size_t& map_size);
+void unmap_file_range(char* ptr, size_t size);
+// CPUs of each NUMA node of the system, empty if the topology is not available.
+std::vector<std::vector<int>> numa_nodes();
 
 #ifdef _MSC_VER
 #define POPEN _popen
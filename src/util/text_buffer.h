@@ -234,8 +234,8 @@ struct TextBuffer
 		return *this;
 	}
 
-	template<typename _t>
-	TextBuffer& operator<<(const std::vector<_t> &v)
+	template<typename _t, typename _alloc>
+	TextBuffer& operator<<(const std::vector<_t, _alloc> &v)
 	{
 		const size_t l = v.size() * sizeof(_t);
 		reserve(l);